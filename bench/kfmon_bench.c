@@ -0,0 +1,569 @@
+/*
+	KFMon: Kobo inotify-based launcher
+	Copyright (C) 2016-2019 NiLuJe <ninuje@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as
+	published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Synthetic benchmark for the event -> launch path.
+// NOTE: Built via make bench, on top of the NILUJE sandbox (i.e., w/ fake FBInk),
+//       with every path pointing to a scratch directory (KFMON_BENCH_DIR, ideally on a tmpfs).
+//       We pull in kfmon.c wholesale so that we can poke at its (static) internals directly.
+//       That also lets us sanity check the watch state machine before benchmarking anything.
+
+#ifndef KFMON_BENCH
+#	error "This is meant to be built via make bench!"
+#endif
+
+// We provide our own main
+int kfmon_main(int, char*[]);
+#define main kfmon_main
+#include "../kfmon.c"
+#undef main
+
+#include <getopt.h>
+
+// Where our fake Nickel lives
+#define BENCH_ICONS_DIR KFMON_TARGET_MOUNTPOINT "/icons"
+
+static int      mkdir_p(const char*);
+static int      touch(const char*);
+static void     make_image_id(const char*, char*, size_t);
+static int      setup_library(size_t, size_t);
+static void     setup_watches(size_t);
+static void     reap_all(void);
+static uint64_t elapsed_us(const struct timespec*);
+static int      cmp_u64(const void*, const void*);
+static void     report_percentiles(const char*, uint64_t*, size_t);
+static bool     check_watch_fsm(size_t);
+static void     bench_processed_check(size_t, size_t);
+static void     bench_spawn(size_t, size_t);
+static void     bench_events(size_t, size_t);
+static void     usage(const char*);
+
+// mkdir -p, more or less
+static int
+    mkdir_p(const char* path)
+{
+	char buf[KFMON_PATH_MAX];
+	snprintf(buf, sizeof(buf), "%s", path);
+
+	for (char* p = buf + 1; *p; p++) {
+		if (*p == '/') {
+			*p = '\0';
+			if (mkdir(buf, 0755) == -1 && errno != EEXIST) {
+				perror("[KFMon] [ERR!] mkdir");
+				return -1;
+			}
+			*p = '/';
+		}
+	}
+	if (mkdir(buf, 0755) == -1 && errno != EEXIST) {
+		perror("[KFMon] [ERR!] mkdir");
+		return -1;
+	}
+
+	return 0;
+}
+
+// Create an empty file
+static int
+    touch(const char* path)
+{
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd == -1) {
+		perror("[KFMon] [ERR!] open");
+		return -1;
+	}
+	close(fd);
+
+	return 0;
+}
+
+// Nickel's ImageIDs for sideloaded content are the path with a few separators swapped for underscores
+static void
+    make_image_id(const char* path, char* image_id, size_t len)
+{
+	snprintf(image_id, len, "%s", path);
+	for (char* p = image_id; *p; p++) {
+		if (*p == '/' || *p == ':' || *p == '.' || *p == ' ') {
+			*p = '_';
+		}
+	}
+}
+
+// Build a fake Library: rows content entries (the first watches of which are our icons),
+// each with its set of thumbnails in .kobo-images
+static int
+    setup_library(size_t rows, size_t watches)
+{
+	if (mkdir_p(KFMON_TARGET_MOUNTPOINT "/.kobo") != 0 || mkdir_p(BENCH_ICONS_DIR) != 0) {
+		return -1;
+	}
+	unlink(KOBO_DB_PATH);
+	unlink(KFMON_PROCESSED_CACHE);
+
+	sqlite3* db;
+	if (sqlite3_open(KOBO_DB_PATH, &db) != SQLITE_OK) {
+		fprintf(stderr, "Failed to create %s: %s\n", KOBO_DB_PATH, sqlite3_errmsg(db));
+		sqlite3_close(db);
+		return -1;
+	}
+	// NOTE: A trimmed down version of Nickel's own schema, keeping only what we care about.
+	if (sqlite3_exec(db,
+			 "PRAGMA journal_mode = WAL;"
+			 "CREATE TABLE content (ContentID TEXT NOT NULL, ContentType TEXT NOT NULL, ImageID TEXT,"
+			 " Title TEXT, Attribution TEXT, Description TEXT, PRIMARY KEY (ContentID));"
+			 "BEGIN;",
+			 NULL,
+			 NULL,
+			 NULL) != SQLITE_OK) {
+		fprintf(stderr, "Failed to setup %s: %s\n", KOBO_DB_PATH, sqlite3_errmsg(db));
+		sqlite3_close(db);
+		return -1;
+	}
+
+	sqlite3_stmt* stmt;
+	if (sqlite3_prepare_v2(db,
+			       "INSERT INTO content VALUES (@id, @type, @image_id, @title, '', '');",
+			       -1,
+			       &stmt,
+			       NULL) != SQLITE_OK) {
+		fprintf(stderr, "Failed to prepare INSERT: %s\n", sqlite3_errmsg(db));
+		sqlite3_close(db);
+		return -1;
+	}
+
+	for (size_t i = 0U; i < rows; i++) {
+		char path[KFMON_PATH_MAX];
+		char title[DB_SZ_MAX];
+		if (i < watches) {
+			snprintf(path, sizeof(path), "%s/icon%zu.png", BENCH_ICONS_DIR, i);
+			snprintf(title, sizeof(title), "icon%zu", i);
+			if (touch(path) != 0) {
+				return -1;
+			}
+		} else {
+			snprintf(path, sizeof(path), "%s/books/book%zu.epub", KFMON_TARGET_MOUNTPOINT, i);
+			snprintf(title, sizeof(title), "Book %zu", i);
+		}
+		char content_id[KFMON_PATH_MAX + 7];
+		snprintf(content_id, sizeof(content_id), "file://%s", path);
+		char image_id[KFMON_PATH_MAX];
+		make_image_id(content_id, image_id, sizeof(image_id));
+
+		sqlite3_bind_text(stmt, 1, content_id, -1, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 2, "6", -1, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 3, image_id, -1, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 4, title, -1, SQLITE_STATIC);
+		if (sqlite3_step(stmt) != SQLITE_DONE) {
+			fprintf(stderr, "Failed to INSERT row %zu: %s\n", i, sqlite3_errmsg(db));
+			sqlite3_finalize(stmt);
+			sqlite3_close(db);
+			return -1;
+		}
+		sqlite3_reset(stmt);
+
+		for (ThumbnailKind kind = THUMBNAIL_N3_FULL; kind < THUMBNAIL_KIND_COUNT; kind++) {
+			char thumbnail_path[KFMON_PATH_MAX];
+			get_thumbnail_path(image_id, kind, thumbnail_path, sizeof(thumbnail_path));
+			*strrchr(thumbnail_path, '/') = '\0';
+			if (mkdir_p(thumbnail_path) != 0) {
+				return -1;
+			}
+			get_thumbnail_path(image_id, kind, thumbnail_path, sizeof(thumbnail_path));
+			if (touch(thumbnail_path) != 0) {
+				return -1;
+			}
+		}
+	}
+
+	sqlite3_finalize(stmt);
+	sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+	sqlite3_close(db);
+
+	return 0;
+}
+
+// Setup a watch per icon, all of them launching /bin/true
+static void
+    setup_watches(size_t watches)
+{
+	daemon_config.db_timeout         = 500U;
+	daemon_config.use_syslog         = false;
+	daemon_config.with_notifications = true;
+
+	for (size_t i = 0U; i < watches; i++) {
+		ssize_t new_idx = add_watch_config();
+		if (new_idx < 0) {
+			exit(EXIT_FAILURE);
+		}
+		WatchConfig* watch = &watch_config[new_idx];
+		snprintf(watch->filename, sizeof(watch->filename), "%s/icon%zu.png", BENCH_ICONS_DIR, i);
+		snprintf(watch->action, sizeof(watch->action), "%s", "/bin/true");
+	}
+}
+
+// Synchronously reap whatever we've spawned
+static void
+    reap_all(void)
+{
+	for (size_t i = 0U; i < PT.size; i++) {
+		if (PT.spawn_pids[i] != -1) {
+			int wstatus;
+			while (waitpid(PT.spawn_pids[i], &wstatus, 0) == -1 && errno == EINTR) {
+				;
+			}
+			reap_process(i, wstatus);
+		}
+	}
+}
+
+static uint64_t
+    elapsed_us(const struct timespec* start)
+{
+	struct timespec now;
+	get_monotonic_time(&now);
+
+	return (uint64_t) ((now.tv_sec - start->tv_sec) * 1000000 + (now.tv_nsec - start->tv_nsec) / 1000);
+}
+
+static int
+    cmp_u64(const void* a, const void* b)
+{
+	uint64_t x = *(const uint64_t*) a;
+	uint64_t y = *(const uint64_t*) b;
+
+	return (x > y) - (x < y);
+}
+
+static void
+    report_percentiles(const char* what, uint64_t* samples, size_t count)
+{
+	qsort(samples, count, sizeof(*samples), cmp_u64);
+	printf("%-32s p50 %8llu us | p99 %8llu us | max %8llu us (%zu samples)\n",
+	       what,
+	       (unsigned long long) samples[count / 2U],
+	       (unsigned long long) samples[(count * 99U) / 100U],
+	       (unsigned long long) samples[count - 1U],
+	       count);
+}
+
+// Check next_watch_state against a table of expected transitions (WATCH_STATE_COUNT meaning it's rejected),
+// then make sure a watch pending processing doesn't get in the way of a tap on another one.
+static bool
+    check_watch_fsm(size_t watches)
+{
+	const struct
+	{
+		WatchState from;
+		WatchEvent event;
+		WatchState to;
+	} transitions[] = {
+		// A plain tap on a processed icon
+		{ WATCH_IDLE, WATCH_EV_OPEN_PROCESSED, WATCH_OPENED },
+		{ WATCH_OPENED, WATCH_EV_CLOSE_PROCESSED, WATCH_READY },
+		{ WATCH_READY, WATCH_EV_LAUNCH, WATCH_SPAWNED },
+		{ WATCH_SPAWNED, WATCH_EV_EXEC_OK, WATCH_RUNNING },
+		{ WATCH_RUNNING, WATCH_EV_REAPED, WATCH_IDLE },
+		// Nickel was still processing it on OPEN
+		{ WATCH_IDLE, WATCH_EV_OPEN_UNPROCESSED, WATCH_PENDING },
+		{ WATCH_PENDING, WATCH_EV_CLOSE_UNPROCESSED, WATCH_IDLE },
+		{ WATCH_PENDING, WATCH_EV_OPEN_PROCESSED, WATCH_OPENED },
+		{ WATCH_OPENED, WATCH_EV_OPEN_UNPROCESSED, WATCH_PENDING },
+		{ WATCH_OPENED, WATCH_EV_CLOSE_UNPROCESSED, WATCH_IDLE },
+		// A CLOSE w/o an OPEN (f.g., after a debounced burst), or a trigger from kfmon-ctl
+		{ WATCH_IDLE, WATCH_EV_CLOSE_PROCESSED, WATCH_READY },
+		{ WATCH_IDLE, WATCH_EV_LAUNCH, WATCH_SPAWNED },
+		// Deferred launches (c.f., handle_db_wait)
+		{ WATCH_READY, WATCH_EV_OPEN_PROCESSED, WATCH_READY },
+		{ WATCH_READY, WATCH_EV_CLOSE_UNPROCESSED, WATCH_READY },
+		{ WATCH_READY, WATCH_EV_CANCEL, WATCH_IDLE },
+		{ WATCH_PENDING, WATCH_EV_CANCEL, WATCH_IDLE },
+		// Failed spawns
+		{ WATCH_SPAWNED, WATCH_EV_EXEC_FAILED, WATCH_IDLE },
+		// Nothing short of its death gets a running watch out of there
+		{ WATCH_RUNNING, WATCH_EV_OPEN_UNPROCESSED, WATCH_RUNNING },
+		{ WATCH_RUNNING, WATCH_EV_CLOSE_PROCESSED, WATCH_RUNNING },
+		{ WATCH_RUNNING, WATCH_EV_CANCEL, WATCH_RUNNING },
+		// Nonsense
+		{ WATCH_IDLE, WATCH_EV_EXEC_OK, WATCH_STATE_COUNT },
+		{ WATCH_IDLE, WATCH_EV_REAPED, WATCH_STATE_COUNT },
+		{ WATCH_READY, WATCH_EV_EXEC_FAILED, WATCH_STATE_COUNT },
+		{ WATCH_SPAWNED, WATCH_EV_OPEN_PROCESSED, WATCH_STATE_COUNT },
+		{ WATCH_SPAWNED, WATCH_EV_LAUNCH, WATCH_STATE_COUNT },
+		{ WATCH_RUNNING, WATCH_EV_LAUNCH, WATCH_STATE_COUNT },
+		{ WATCH_STATE_COUNT, WATCH_EV_OPEN_PROCESSED, WATCH_STATE_COUNT },
+	};
+
+	size_t failures = 0U;
+	for (size_t i = 0U; i < sizeof(transitions) / sizeof(*transitions); i++) {
+		WatchState to = next_watch_state(transitions[i].from, transitions[i].event);
+		if (to != transitions[i].to) {
+			printf("FAIL: %s + %s -> %s (expected %s)\n",
+			       get_watch_state_name(transitions[i].from),
+			       get_watch_event_name(transitions[i].event),
+			       get_watch_state_name(to),
+			       get_watch_state_name(transitions[i].to));
+			failures++;
+		}
+	}
+
+	// Watch 0 is pending processing, a tap on watch 1 should still go through.
+	if (watches >= 2U) {
+		uint64_t check_us = 0U;
+		uint64_t spawn_us = 0U;
+		pid_t    spid     = -1;
+		watch_config[0].state = WATCH_PENDING;
+		handle_watch_event(1U, IN_OPEN, &check_us, &spawn_us, &spid);
+		JournalDecision decision = handle_watch_event(1U, IN_CLOSE, &check_us, &spawn_us, &spid);
+		if (decision != JOURNAL_SPAWNED || watch_config[0].state != WATCH_PENDING) {
+			printf("FAIL: a pending watch 0 prevented watch 1 from launching (decision %d, watch 0 is %s)\n",
+			       (int) decision,
+			       get_watch_state_name(watch_config[0].state));
+			failures++;
+		}
+		reap_all();
+		watch_config[0].state = WATCH_IDLE;
+		if (watch_config[1].state != WATCH_IDLE) {
+			printf("FAIL: watch 1 is %s after being reaped\n", get_watch_state_name(watch_config[1].state));
+			failures++;
+		}
+	}
+
+	printf("%-32s %zu transitions checked, %zu failures\n\n",
+	       "watch state machine",
+	       sizeof(transitions) / sizeof(*transitions),
+	       failures);
+	return failures == 0U;
+}
+
+// is_target_processed(), both from a cold cache (i.e., hitting the DB), and from a warm one
+static void
+    bench_processed_check(size_t watches, size_t iterations)
+{
+	size_t    count  = watches * iterations;
+	uint64_t* cold   = calloc(count, sizeof(*cold));
+	uint64_t* warm   = calloc(count, sizeof(*warm));
+	size_t    n      = 0U;
+	size_t    misses = 0U;
+	if (cold == NULL || warm == NULL) {
+		perror("[KFMon] [ERR!] calloc");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t i = 0U; i < iterations; i++) {
+		for (size_t watch_idx = 0U; watch_idx < watches; watch_idx++) {
+			struct timespec ts;
+
+			// Forget what we know about it, to force a trip to the DB
+			watch_config[watch_idx].fingerprint = (ProcessedFingerprint){ 0 };
+			get_monotonic_time(&ts);
+			misses += !is_target_processed(watch_idx, true);
+			cold[n] = elapsed_us(&ts);
+
+			// And now that it's cached...
+			get_monotonic_time(&ts);
+			misses += !is_target_processed(watch_idx, true);
+			warm[n] = elapsed_us(&ts);
+
+			n++;
+		}
+	}
+
+	report_percentiles("is_target_processed (DB)", cold, n);
+	report_percentiles("is_target_processed (cached)", warm, n);
+	if (misses) {
+		printf("WARNING: %zu checks unexpectedly failed, check %s!\n", misses, KFMON_LOGFILE);
+	}
+
+	free(cold);
+	free(warm);
+}
+
+// spawn(), from vfork to a confirmed exec
+static void
+    bench_spawn(size_t watches, size_t iterations)
+{
+	size_t    count   = watches * iterations;
+	uint64_t* samples = calloc(count, sizeof(*samples));
+	size_t    n       = 0U;
+	if (samples == NULL) {
+		perror("[KFMon] [ERR!] calloc");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t i = 0U; i < iterations; i++) {
+		for (size_t watch_idx = 0U; watch_idx < watches; watch_idx++) {
+			char* const     cmd[] = { watch_config[watch_idx].action, NULL };
+			struct timespec ts;
+			get_monotonic_time(&ts);
+			// NOTE: Pretend the event that triggered this just came in, for the daemon's own stats.
+			event_ts = ts;
+			spawn(cmd, watch_idx);
+			samples[n++] = elapsed_us(&ts);
+		}
+		reap_all();
+	}
+
+	report_percentiles("spawn (vfork -> exec)", samples, n);
+
+	free(samples);
+}
+
+// OPEN/CLOSE storms on our watched icons, fed through handle_events()
+static void
+    bench_events(size_t watches, size_t iterations)
+{
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd == -1) {
+		perror("[KFMon] [ERR!] inotify_init1");
+		exit(EXIT_FAILURE);
+	}
+	wlt_clear(&wd_table);
+	for (size_t watch_idx = 0U; watch_idx < watches; watch_idx++) {
+		set_watch_wd(watch_idx, inotify_add_watch(fd, watch_config[watch_idx].filename, IN_OPEN | IN_CLOSE));
+		if (watch_config[watch_idx].inotify_wd == -1) {
+			perror("[KFMon] [ERR!] inotify_add_watch");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	uint64_t  total_us = 0U;
+	size_t    events   = 0U;
+	uint64_t* samples  = calloc(iterations, sizeof(*samples));
+	if (samples == NULL) {
+		perror("[KFMon] [ERR!] calloc");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t i = 0U; i < iterations; i++) {
+		// Tap every icon once (i.e., an OPEN & a CLOSE each)...
+		for (size_t watch_idx = 0U; watch_idx < watches; watch_idx++) {
+			int tfd = open(watch_config[watch_idx].filename, O_RDONLY | O_CLOEXEC);
+			if (tfd != -1) {
+				close(tfd);
+				events += 2U;
+			}
+		}
+
+		// ...and see how long it takes us to chew through that.
+		struct timespec ts;
+		get_monotonic_time(&ts);
+		handle_events(fd);
+		samples[i] = elapsed_us(&ts);
+		total_us += samples[i];
+
+		reap_all();
+	}
+
+	report_percentiles("handle_events (per storm)", samples, iterations);
+	printf("%-32s %zu events in %llu us (%.0f events/s)\n",
+	       "handle_events (throughput)",
+	       events,
+	       (unsigned long long) total_us,
+	       total_us ? (double) events * 1000000.0 / (double) total_us : 0.0);
+
+	free(samples);
+	close(fd);
+}
+
+static void
+    usage(const char* name)
+{
+	printf("Usage: %s [-r rows] [-w watches] [-n iterations]\n"
+	       "\n"
+	       "\t-r\tNumber of content rows in the fake Nickel DB (default: 5000)\n"
+	       "\t-w\tNumber of watched icons (default: 8)\n"
+	       "\t-n\tNumber of iterations for each benchmark (default: 200)\n"
+	       "\n"
+	       "Everything happens in %s (the log ends up in %s)\n",
+	       name,
+	       KFMON_BENCH_DIR,
+	       KFMON_LOGFILE);
+}
+
+int
+    main(int argc, char* argv[])
+{
+	size_t rows       = 5000U;
+	size_t watches    = 8U;
+	size_t iterations = 200U;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "r:w:n:h")) != -1) {
+		switch (opt) {
+			case 'r':
+				rows = strtoul(optarg, NULL, 10);
+				break;
+			case 'w':
+				watches = strtoul(optarg, NULL, 10);
+				break;
+			case 'n':
+				iterations = strtoul(optarg, NULL, 10);
+				break;
+			default:
+				usage(argv[0]);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (watches == 0U || iterations == 0U) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	rows = MAX(rows, watches);
+
+	printf("Setting up %zu content rows & %zu watches in %s . . .\n", rows, watches, KFMON_BENCH_DIR);
+	if (setup_library(rows, watches) != 0) {
+		return EXIT_FAILURE;
+	}
+
+	// Our spawns get our actual stdio, but our own logging goes to the log file
+	orig_stdin  = dup(fileno(stdin));
+	orig_stdout = dup(fileno(stdout));
+	orig_stderr = dup(fileno(stderr));
+	int lfd     = open(KFMON_LOGFILE, O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+	if (lfd == -1) {
+		perror("[KFMon] [ERR!] open log");
+		return EXIT_FAILURE;
+	}
+	dup2(lfd, fileno(stderr));
+	close(lfd);
+
+	setup_watches(watches);
+	if (init_process_table() != 0 || init_signals() != 0) {
+		return EXIT_FAILURE;
+	}
+	// We don't actually want to have to SIGKILL ourselves to get out of here ;).
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGTERM);
+	sigprocmask(SIG_UNBLOCK, &mask, NULL);
+
+	if (!check_watch_fsm(watches)) {
+		return EXIT_FAILURE;
+	}
+
+	printf("Running %zu iterations per benchmark . . .\n\n", iterations);
+	bench_processed_check(watches, iterations);
+	bench_spawn(watches, iterations);
+	bench_events(watches, iterations);
+
+	// Leave the daemon's own view of things in the log, too
+	dump_latency_histograms();
+	close_nickel_db();
+
+	return EXIT_SUCCESS;
+}
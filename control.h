@@ -0,0 +1,40 @@
+/*
+	KFMon: Kobo inotify-based launcher
+	Copyright (C) 2016-2019 NiLuJe <ninuje@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as
+	published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __KFMON_CONTROL_H
+#define __KFMON_CONTROL_H
+
+// The protocol spoken over our control socket, shared between kfmon & its client (utils/kfmon-ctl.c).
+// It's as dumb as it gets: one command per connection. The client sends a single line, and shuts down its end,
+// kfmon replies, and closes the connection.
+// A reply starts with a status line, either "OK", or "ERR: " followed by a human-readable message,
+// and, on success, goes on with as many lines of tab-separated fields as the command calls for.
+//
+// Commands:
+//     list              One line per watch: idx, armed (armed, missing or disarmed), state (c.f., WatchState),
+//                       pid, flags, config file, target file, action, spawn attributes (i.e., how its action is run,
+//                       f.g., nice=5,sched=batch,cgroup=kfmon/log, or - if none; the cgroup, if any, always comes last)
+//     stats             Our counters, one per line
+//     trigger <watch>   Launch a watch's action right away, without any of the usual checks on its target file.
+//                       A watch can be referred to by its idx, its config file, or its target file (full path or not).
+//                       That's the whole rest of the line (minus any leading whitespace), spaces included.
+
+// Maximum length of a command line, including its terminating LF
+#define KFMON_CONTROL_CMD_MAX 512U
+
+#endif
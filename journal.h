@@ -0,0 +1,72 @@
+/*
+	KFMon: Kobo inotify-based launcher
+	Copyright (C) 2016-2019 NiLuJe <ninuje@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as
+	published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __KFMON_JOURNAL_H
+#define __KFMON_JOURNAL_H
+
+// On-disk layout of our binary event journal, shared between kfmon & its decoder (utils/kfmon-journal.c).
+// It's a fixed-size file, mmap'ed by kfmon, holding a header, followed by a ring of fixed-size records.
+// NOTE: Everything is stored in native byte order, it's meant to be decoded on the device that wrote it.
+
+#include <stdint.h>
+
+#define KFMON_JOURNAL_MAGIC    "KFMJ"
+#define KFMON_JOURNAL_VERSION  1U
+#define KFMON_JOURNAL_CAPACITY 4096U    // i.e., 128KB worth of records
+
+// What we ended up doing about an event
+typedef enum
+{
+	JOURNAL_NONE = 0U,    // Nothing to decide (f.g., an OPEN on a processed icon, or an IN_IGNORED)
+	JOURNAL_SPAWNED,      // We launched the action
+	JOURNAL_BLOCKED,      // A spawn blocker is running
+	JOURNAL_BUSY,         // This watch's action is still running
+	JOURNAL_PENDING,      // Nickel hasn't finished processing the icon yet
+	JOURNAL_FAILED,       // We tried to launch the action, but it failed
+	JOURNAL_DEFERRED,     // Nickel's DB was busy, the launch is on hold until it settles down
+	JOURNAL_COALESCED,    // Part of a burst of events, we'll only act on it once it has settled down
+	JOURNAL_DECISION_COUNT
+} JournalDecision;
+
+typedef struct
+{
+	char     magic[4];
+	uint32_t version;
+	uint32_t record_size;
+	uint32_t capacity;
+	// Total number of records ever written (i.e., the next one goes in slot next % capacity)
+	uint64_t next;
+	uint64_t reserved;
+} JournalHeader;
+
+typedef struct
+{
+	uint64_t ts_ns;       // CLOCK_REALTIME, in ns
+	uint32_t watch_idx;
+	uint32_t mask;        // inotify event mask
+	uint32_t check_us;    // Time spent in is_target_processed()
+	uint32_t spawn_us;    // Time spent in spawn()
+	int32_t  pid;         // Spawned pid, if any
+	uint8_t  decision;    // JournalDecision
+	uint8_t  reserved[3];
+} JournalRecord;
+
+_Static_assert(sizeof(JournalHeader) == 32U, "Unexpected JournalHeader size");
+_Static_assert(sizeof(JournalRecord) == 32U, "Unexpected JournalRecord size");
+
+#endif
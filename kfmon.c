@@ -152,16 +152,6 @@ static int
 	return 0;
 }
 
-// Wrapper around localtime_r, making sure this part is thread-safe (used for logging)
-struct tm*
-    get_localtime(struct tm* lt)
-{
-	time_t t = time(NULL);
-	tzset();
-
-	return localtime_r(&t, lt);
-}
-
 // Wrapper around strftime, making sure this part is thread-safe (used for logging)
 char*
     format_localtime(struct tm* lt, char* sz_time, size_t len)
@@ -173,26 +163,23 @@ char*
 }
 
 // Return the current time formatted as 2016-04-29 @ 20:44:13 (used for logging)
-// NOTE: The use of static variables prevents this from being thread-safe,
-//       but in the main thread, we use static storage for simplicity's sake.
+// NOTE: We use static storage for simplicity's sake, but it's thread-local,
+//       so our notifier thread can log, too.
+// NOTE: We only ever format it once per second, and we only call tzset once, in main.
 char*
     get_current_time(void)
 {
-	static struct tm local_tm = { 0 };
-	struct tm*       lt       = get_localtime(&local_tm);
+	static __thread time_t last_t = -1;
+	static __thread char   sz_time[22];
 
-	static char sz_time[22];
-
-	return format_localtime(lt, sz_time, sizeof(sz_time));
-}
+	time_t t = time(NULL);
+	if (t != last_t) {
+		struct tm local_tm;
+		format_localtime(localtime_r(&t, &local_tm), sz_time, sizeof(sz_time));
+		last_t = t;
+	}
 
-// And now the same, but with user supplied storage, thus potentially thread-safe:
-// f.g., we use the stack in reaper_thread().
-char*
-    get_current_time_r(struct tm* local_tm, char* sz_time, size_t len)
-{
-	struct tm* lt = get_localtime(local_tm);
-	return format_localtime(lt, sz_time, len);
+	return sz_time;
 }
 
 const char*
@@ -217,62 +204,491 @@ const char*
 	}
 }
 
-// Check that our target mountpoint is indeed mounted...
-static bool
-    is_target_mounted(void)
+// Format a log record, and push it to our ring buffer (or straight to stderr if our writer thread isn't up).
+// NOTE: Never blocks: if the ring is full, the record is dropped, and the writer will let us know about it.
+void
+    log_record(const char* fmt, ...)
 {
-	// c.f., http://program-nix.blogspot.com/2008/08/c-language-check-filesystem-is-mounted.html
-	FILE*          mtab       = NULL;
-	struct mntent* part       = NULL;
-	bool           is_mounted = false;
+	va_list args;
+
+	if (!atomic_load(&log_ring.is_running)) {
+		va_start(args, fmt);
+		vfprintf(stderr, fmt, args);
+		va_end(args);
+		return;
+	}
 
-	if ((mtab = setmntent("/proc/mounts", "r")) != NULL) {
-		while ((part = getmntent(mtab)) != NULL) {
-			DBGLOG("Checking fs %s mounted on %s", part->mnt_fsname, part->mnt_dir);
-			if ((part->mnt_dir != NULL) && (strcmp(part->mnt_dir, KFMON_TARGET_MOUNTPOINT)) == 0) {
-				is_mounted = true;
+	// Claim a slot
+	size_t     pos = atomic_load_explicit(&log_ring.head, memory_order_relaxed);
+	LogRecord* rec;
+	for (;;) {
+		rec          = &log_ring.slots[pos & (LOG_RING_SLOTS - 1U)];
+		size_t   seq = atomic_load_explicit(&rec->seq, memory_order_acquire);
+		intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+		if (dif == 0) {
+			if (atomic_compare_exchange_weak_explicit(
+				&log_ring.head, &pos, pos + 1U, memory_order_relaxed, memory_order_relaxed)) {
 				break;
 			}
+		} else if (dif < 0) {
+			// The ring is full
+			atomic_fetch_add_explicit(&log_ring.dropped, 1U, memory_order_relaxed);
+			return;
+		} else {
+			pos = atomic_load_explicit(&log_ring.head, memory_order_relaxed);
 		}
-		endmntent(mtab);
 	}
 
-	return is_mounted;
+	// Format the record in place
+	va_start(args, fmt);
+	int len = vsnprintf(rec->buf, sizeof(rec->buf), fmt, args);
+	va_end(args);
+	if (len < 0) {
+		len = 0;
+	} else if ((size_t) len >= sizeof(rec->buf)) {
+		// Truncated, make sure it still ends with a LF
+		len               = (int) sizeof(rec->buf) - 1;
+		rec->buf[len - 1] = '\n';
+	}
+	rec->len = (size_t) len;
+
+	// Publish it
+	atomic_store_explicit(&rec->seq, pos + 1U, memory_order_release);
+
+	// And wake the writer up if need be
+	if (atomic_exchange(&log_ring.is_writer_asleep, false)) {
+		// NOTE: Not much we can do if that fails, it'll just pick it up on its next wake up.
+		uint64_t                        one   = 1U;
+		ssize_t __attribute__((unused)) wrote = write(log_ring.wake_fd, &one, sizeof(one));
+	}
+}
+
+// Check whether there's anything left for our writer thread to drain
+static bool
+    log_ring_is_empty(void)
+{
+	const LogRecord* rec = &log_ring.slots[log_ring.tail & (LOG_RING_SLOTS - 1U)];
+	return atomic_load_explicit(&rec->seq, memory_order_acquire) != log_ring.tail + 1U;
 }
 
-// Monitor mountpoint activity...
+// write() the full buffer to our logfile, no matter what
 static void
-    wait_for_target_mountpoint(void)
+    log_write_all(const char* buf, size_t len)
 {
-	// c.f., https://stackoverflow.com/questions/5070801
-	int           mfd = open("/proc/mounts", O_RDONLY, 0);
-	struct pollfd pfd;
+	while (len > 0U) {
+		ssize_t wrote = write(STDERR_FILENO, buf, len);
+		if (wrote == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			// Nowhere to log that...
+			return;
+		}
+		buf += wrote;
+		len -= (size_t) wrote;
+	}
+}
 
-	uint8_t changes = 0;
-	pfd.fd          = mfd;
-	pfd.events      = POLLERR | POLLPRI;
-	pfd.revents     = 0;
-	while (poll(&pfd, 1, -1) >= 0) {
-		if (pfd.revents & POLLERR) {
-			LOG(LOG_INFO, "Mountpoints changed (iteration nr. %hhu)", (uint8_t) changes++);
+// Drain our log ring in batches, so we only ever hit the logfile (i.e., the flash) with a handful of writes.
+void*
+    log_writer_thread(void* arg __attribute__((unused)))
+{
+	char   batch[LOG_BATCH_SIZE];
+	size_t len = 0U;
 
-			// Stop polling once we know our mountpoint is available...
-			if (is_target_mounted()) {
-				LOG(LOG_NOTICE, "Yay! Target mountpoint is available!");
+	for (;;) {
+		// NOTE: Sample this *before* draining, so we never exit w/ records pushed before stop_logger pending.
+		bool is_running = atomic_load(&log_ring.is_running);
+
+		while (!log_ring_is_empty()) {
+			LogRecord* rec = &log_ring.slots[log_ring.tail & (LOG_RING_SLOTS - 1U)];
+			if (len + rec->len > sizeof(batch)) {
+				log_write_all(batch, len);
+				len = 0U;
+			}
+			memcpy(batch + len, rec->buf, rec->len);
+			len += rec->len;
+			atomic_store_explicit(&rec->seq, log_ring.tail + LOG_RING_SLOTS, memory_order_release);
+			log_ring.tail++;
+		}
+
+		size_t dropped = atomic_exchange(&log_ring.dropped, 0U);
+		if (dropped > 0U) {
+			char msg[128];
+			int  mlen = snprintf(msg,
+					     sizeof(msg),
+					     "[KFMon] [%s] [WARN] Log ring overflowed, dropped %zu records\n",
+					     get_current_time(),
+					     dropped);
+			if (len + (size_t) mlen > sizeof(batch)) {
+				log_write_all(batch, len);
+				len = 0U;
+			}
+			memcpy(batch + len, msg, (size_t) mlen);
+			len += (size_t) mlen;
+		}
+
+		if (len > 0U) {
+			log_write_all(batch, len);
+			len = 0U;
+		}
+
+		if (!is_running) {
+			break;
+		}
+
+		// Go to sleep until someone pushes something new...
+		atomic_store(&log_ring.is_writer_asleep, true);
+		// NOTE: Make sure nothing was pushed right before we flagged ourselves as asleep, as we'd miss the wake up.
+		if (!log_ring_is_empty() || !atomic_load(&log_ring.is_running)) {
+			atomic_store(&log_ring.is_writer_asleep, false);
+			continue;
+		}
+		uint64_t count;
+		while (read(log_ring.wake_fd, &count, sizeof(count)) == -1 && errno == EINTR) {    // Flawfinder: ignore
+			;
+		}
+		// Then give a burst of records the chance to pile up, so we can write them in one go.
+		if (atomic_load(&log_ring.is_running)) {
+			const struct timespec zzz = { 0L, LOG_COALESCE_DELAY };
+			nanosleep(&zzz, NULL);
+		}
+	}
+
+	return (void*) NULL;
+}
+
+// Spin up our log writer thread
+static int
+    start_logger(void)
+{
+	for (size_t i = 0U; i < LOG_RING_SLOTS; i++) {
+		atomic_init(&log_ring.slots[i].seq, i);
+	}
+	atomic_init(&log_ring.head, 0U);
+	atomic_init(&log_ring.dropped, 0U);
+	atomic_init(&log_ring.is_writer_asleep, false);
+	log_ring.tail = 0U;
+
+	log_ring.wake_fd = eventfd(0U, EFD_CLOEXEC);
+	if (log_ring.wake_fd == -1) {
+		perror("[KFMon] [ERR!] eventfd");
+		return -1;
+	}
+
+	// NOTE: Make sure the writer thread never catches any signal, we handle them synchronously in the main thread.
+	sigset_t all;
+	sigset_t prev;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &prev);
+	atomic_store(&log_ring.is_running, true);
+	int rc = pthread_create(&log_ring.writer, NULL, log_writer_thread, NULL);
+	pthread_sigmask(SIG_SETMASK, &prev, NULL);
+	if (rc != 0) {
+		atomic_store(&log_ring.is_running, false);
+		close(log_ring.wake_fd);
+		errno = rc;
+		perror("[KFMon] [ERR!] pthread_create");
+		return -1;
+	}
+	pthread_setname_np(log_ring.writer, "Logger");
+
+	return 0;
+}
+
+// Flush our log ring, and stop the writer thread (registered via atexit, so we don't lose anything on exit)
+static void
+    stop_logger(void)
+{
+	if (!atomic_load(&log_ring.is_running)) {
+		return;
+	}
+
+	atomic_store(&log_ring.is_running, false);
+	uint64_t one = 1U;
+	if (write(log_ring.wake_fd, &one, sizeof(one)) == -1) {
+		perror("[KFMon] [WARN] write");
+	}
+	pthread_join(log_ring.writer, NULL);
+	close(log_ring.wake_fd);
+}
+
+// Queue an on-screen notification for our notifier thread (or show it right away if it isn't up).
+// NOTE: Never blocks on FBInk: if the queue is full, the message is dropped, and the notifier will let us know about it.
+static void
+    notify(const char* fmt, ...)
+{
+	va_list args;
+
+	pthread_mutex_lock(&notify_queue.lock);
+	if (!notify_queue.is_running) {
+		pthread_mutex_unlock(&notify_queue.lock);
+		char msg[NOTIFY_MSG_MAX];
+		va_start(args, fmt);
+		vsnprintf(msg, sizeof(msg), fmt, args);
+		va_end(args);
+		fbink_print(FBFD_AUTO, msg, &fbink_config);
+		return;
+	}
+
+	if (notify_queue.count == NOTIFY_QUEUE_SLOTS) {
+		notify_queue.dropped++;
+	} else {
+		char* msg = notify_queue.msgs[(notify_queue.tail + notify_queue.count) % NOTIFY_QUEUE_SLOTS];
+		va_start(args, fmt);
+		vsnprintf(msg, NOTIFY_MSG_MAX, fmt, args);
+		va_end(args);
+		notify_queue.count++;
+		pthread_cond_signal(&notify_queue.cond);
+	}
+	pthread_mutex_unlock(&notify_queue.lock);
+}
+
+// Show our queued notifications, coalescing those that arrive together into a single refresh
+void*
+    notifier_thread(void* arg __attribute__((unused)))
+{
+	// Remember what we've recently shown, so we don't flash the same thing over and over
+	struct
+	{
+		size_t hash;
+		time_t shown;
+	} history[NOTIFY_HISTORY] = { 0 };
+	size_t history_idx        = 0U;
+	char   msgs[NOTIFY_QUEUE_SLOTS][NOTIFY_MSG_MAX];
+	char   batch[NOTIFY_MSG_MAX * 2U];
+
+	for (;;) {
+		pthread_mutex_lock(&notify_queue.lock);
+		while (notify_queue.count == 0U && notify_queue.is_running) {
+			pthread_cond_wait(&notify_queue.cond, &notify_queue.lock);
+		}
+		bool is_running = notify_queue.is_running;
+		if (notify_queue.count == 0U) {
+			pthread_mutex_unlock(&notify_queue.lock);
+			break;
+		}
+		pthread_mutex_unlock(&notify_queue.lock);
+
+		// Give a burst of messages the chance to pile up, so we can show them in one go.
+		if (is_running) {
+			const struct timespec zzz = { 0L, NOTIFY_COALESCE_DELAY };
+			nanosleep(&zzz, NULL);
+		}
+
+		pthread_mutex_lock(&notify_queue.lock);
+		size_t count = notify_queue.count;
+		for (size_t i = 0U; i < count; i++) {
+			memcpy(msgs[i], notify_queue.msgs[(notify_queue.tail + i) % NOTIFY_QUEUE_SLOTS], NOTIFY_MSG_MAX);
+		}
+		notify_queue.tail    = (notify_queue.tail + count) % NOTIFY_QUEUE_SLOTS;
+		notify_queue.count   = 0U;
+		size_t dropped       = notify_queue.dropped;
+		notify_queue.dropped = 0U;
+		pthread_mutex_unlock(&notify_queue.lock);
+
+		struct timespec now;
+		get_monotonic_time(&now);
+		size_t len     = 0U;
+		size_t skipped = 0U;
+		for (size_t i = 0U; i < count; i++) {
+			size_t msg_len = strlen(msgs[i]);
+			size_t hash    = (size_t) qhash((const unsigned char*) msgs[i], msg_len);
+			bool   is_dupe = false;
+			for (size_t n = 0U; n < NOTIFY_HISTORY; n++) {
+				if (history[n].hash == hash && history[n].shown != 0 &&
+				    now.tv_sec - history[n].shown < NOTIFY_REPEAT_DELAY) {
+					is_dupe = true;
+					break;
+				}
+			}
+			if (is_dupe) {
+				skipped++;
+				continue;
+			}
+			history[history_idx].hash  = hash;
+			history[history_idx].shown = now.tv_sec;
+			history_idx                = (history_idx + 1U) % NOTIFY_HISTORY;
+
+			// Only keep our tag on the first one
+			const char* msg = msgs[i];
+			if (len > 0U && strncmp(msg, "[KFMon] ", 8U) == 0) {
+				msg += 8U;
+			}
+			int ret = snprintf(batch + len, sizeof(batch) - len, "%s%s", len > 0U ? " | " : "", msg);
+			if (ret < 0 || (size_t) ret >= sizeof(batch) - len) {
+				len = sizeof(batch) - 1U;
 				break;
 			}
+			len += (size_t) ret;
 		}
-		pfd.revents = 0;
 
-		// If we can't find our mountpoint after that many changes, assume we're screwed...
-		if (changes >= 5) {
-			LOG(LOG_ERR, "Too many mountpoint changes without finding our target (shutdown?), aborting!");
-			close(mfd);
-			exit(EXIT_FAILURE);
+		if (skipped > 0U) {
+			LOG(LOG_INFO, "Skipped %zu on-screen notifications we've just shown", skipped);
+		}
+		if (dropped > 0U) {
+			LOG(LOG_WARNING, "Notification queue overflowed, dropped %zu on-screen notifications", dropped);
+		}
+		if (len > 0U) {
+			refresh_fbink();
+			fbink_print(FBFD_AUTO, batch, &fbink_config);
+		}
+	}
+
+	return (void*) NULL;
+}
+
+// Spin up our notifier thread
+// NOTE: From then on, it's the only thread that gets to touch FBInk.
+static int
+    start_notifier(void)
+{
+	pthread_mutex_init(&notify_queue.lock, NULL);
+	pthread_cond_init(&notify_queue.cond, NULL);
+
+	// NOTE: Same as our logger, leave signal handling to the main thread.
+	sigset_t all;
+	sigset_t prev;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &prev);
+	notify_queue.is_running = true;
+	int rc                  = pthread_create(&notify_queue.notifier, NULL, notifier_thread, NULL);
+	pthread_sigmask(SIG_SETMASK, &prev, NULL);
+	if (rc != 0) {
+		notify_queue.is_running = false;
+		errno                   = rc;
+		perror("[KFMon] [ERR!] pthread_create");
+		return -1;
+	}
+	pthread_setname_np(notify_queue.notifier, "Notifier");
+
+	return 0;
+}
+
+// Show whatever's left in the queue, and stop the notifier thread (registered via atexit, so fatal errors still show)
+static void
+    stop_notifier(void)
+{
+	pthread_mutex_lock(&notify_queue.lock);
+	if (!notify_queue.is_running) {
+		pthread_mutex_unlock(&notify_queue.lock);
+		return;
+	}
+	notify_queue.is_running = false;
+	pthread_cond_signal(&notify_queue.cond);
+	pthread_mutex_unlock(&notify_queue.lock);
+	pthread_join(notify_queue.notifier, NULL);
+}
+
+// Open the mount table we'll keep an eye on, and take a first look at it
+static int
+    open_mount_state(void)
+{
+	mount_state.fd = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+	if (mount_state.fd == -1) {
+		perror("[KFMon] [ERR!] open /proc/self/mountinfo");
+		return -1;
+	}
+	refresh_mount_state();
+
+	return 0;
+}
+
+// Re-parse the mount table to see if our target mountpoint is (still) there. Returns true if that changed.
+// c.f., proc(5) for the format, we only care about the first (mount ID) & fifth (mount point) fields.
+static bool
+    refresh_mount_state(void)
+{
+	// Slurp it in one go, starting from the top
+	size_t len = 0U;
+	for (;;) {
+		if (mount_state.buf_size - len < 4096U) {
+			size_t new_size = mount_state.buf_size ? mount_state.buf_size * 2U : 16384U;
+			char*  new_buf  = realloc(mount_state.buf, new_size);
+			if (new_buf == NULL) {
+				perror("[KFMon] [WARN] realloc");
+				return false;
+			}
+			mount_state.buf      = new_buf;
+			mount_state.buf_size = new_size;
+		}
+		ssize_t nread =
+		    pread(mount_state.fd, mount_state.buf + len, mount_state.buf_size - len - 1U, (off_t) len);
+		if (nread == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("[KFMon] [WARN] pread");
+			return false;
+		}
+		if (nread == 0) {
+			break;
+		}
+		len += (size_t) nread;
+	}
+	mount_state.buf[len] = '\0';
+
+	// NOTE: If it's mounted more than once, the last one wins, as that's the one we'd actually see.
+	bool  is_mounted = false;
+	int   mount_id   = -1;
+	char* saveptr    = NULL;
+	for (char* line = strtok_r(mount_state.buf, "\n", &saveptr); line != NULL;
+	     line       = strtok_r(NULL, "\n", &saveptr)) {
+		int  id;
+		char mnt_dir[PATH_MAX];
+		if (sscanf(line, "%d %*d %*s %*s %4095s", &id, mnt_dir) == 2 &&
+		    strcmp(mnt_dir, KFMON_TARGET_MOUNTPOINT) == 0) {
+			is_mounted = true;
+			mount_id   = id;
 		}
 	}
 
-	close(mfd);
+	if (is_mounted == mount_state.is_mounted && mount_id == mount_state.mount_id) {
+		return false;
+	}
+	DBGLOG("%s is %s (mount ID %d)", KFMON_TARGET_MOUNTPOINT, is_mounted ? "mounted" : "not mounted", mount_id);
+	mount_state.is_mounted = is_mounted;
+	mount_state.mount_id   = mount_id;
+	return true;
+}
+
+// Check that our target mountpoint is indeed mounted...
+// NOTE: That's only as fresh as our last look at the mount table, which we refresh whenever it changes.
+static bool
+    is_target_mounted(void)
+{
+	return mount_state.is_mounted;
+}
+
+// Wait for our target mountpoint to show up
+static void
+    wait_for_target_mountpoint(void)
+{
+	struct pollfd pfds[2];
+
+	pfds[0].fd      = mount_state.fd;
+	pfds[0].events  = POLLPRI;
+	pfds[0].revents = 0;
+	// Keep handling signals (and reaping our spawns) in the meantime
+	pfds[1].fd      = signal_fd;
+	pfds[1].events  = POLLIN;
+	pfds[1].revents = 0;
+	while (poll(pfds, 2, -1) >= 0) {
+		if (pfds[1].revents & POLLIN) {
+			handle_signals();
+		}
+		if (pfds[0].revents & (POLLERR | POLLPRI)) {
+			LOG(LOG_INFO, "Mountpoints changed");
+
+			// Stop polling once we know our mountpoint is available...
+			if (refresh_mount_state() && is_target_mounted()) {
+				LOG(LOG_NOTICE, "Yay! Target mountpoint is available!");
+				break;
+			}
+		}
+		pfds[0].revents = 0;
+		pfds[1].revents = 0;
+	}
 }
 
 // Sanitize user input for keys expecting an unsigned short integer
@@ -421,6 +837,180 @@ static int
 	return -EINVAL;
 }
 
+// Sanitize user input for keys expecting a signed int, within [min, max]
+static int
+    strtol_i(const char* str, int min, int max, int* result)
+{
+	char*    endptr;
+	long int val;
+
+	errno = 0;    // To distinguish success/failure after call
+	val   = strtol(str, &endptr, 10);
+
+	if ((errno == ERANGE && (val == LONG_MAX || val == LONG_MIN)) || (errno != 0 && val == 0)) {
+		perror("[KFMon] [WARN] strtol");
+		return -EINVAL;
+	}
+
+	if (endptr == str) {
+		LOG(LOG_WARNING, "No digits were found in value '%s' assigned to a key expecting an int.", str);
+		return -EINVAL;
+	}
+
+	// Same as in strtoul_hu, we only want an integer, and nothing else.
+	if (*endptr != '\0') {
+		LOG(LOG_WARNING,
+		    "Found trailing characters (%s) behind value '%ld' assigned from string '%s' to a key expecting an int.",
+		    endptr,
+		    val,
+		    str);
+		return -EINVAL;
+	}
+
+	if (val < min || val > max) {
+		LOG(LOG_WARNING, "Value '%ld' is out of range (it should be between %d and %d).", val, min, max);
+		return -EINVAL;
+	}
+
+	*result = (int) val;
+	return EXIT_SUCCESS;
+}
+
+// Scheduling policy, by name (the same ones chrt knows about)
+static int
+    parse_sched_policy(const char* str, int* result)
+{
+	if (strcasecmp(str, "other") == 0 || strcasecmp(str, "normal") == 0) {
+		*result = SCHED_OTHER;
+	} else if (strcasecmp(str, "batch") == 0) {
+		*result = SCHED_BATCH;
+	} else if (strcasecmp(str, "idle") == 0) {
+		*result = SCHED_IDLE;
+	} else if (strcasecmp(str, "fifo") == 0) {
+		*result = SCHED_FIFO;
+	} else if (strcasecmp(str, "rr") == 0) {
+		*result = SCHED_RR;
+	} else {
+		LOG(LOG_WARNING, "Unknown scheduling policy '%s' (expected other, batch, idle, fifo or rr).", str);
+		return -EINVAL;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// I/O scheduling class, by name (the same ones ionice knows about)
+static int
+    parse_ioprio_class(const char* str, int* result)
+{
+	if (strcasecmp(str, "realtime") == 0 || strcasecmp(str, "rt") == 0) {
+		*result = IOPRIO_CLASS_RT;
+	} else if (strcasecmp(str, "best-effort") == 0 || strcasecmp(str, "be") == 0) {
+		*result = IOPRIO_CLASS_BE;
+	} else if (strcasecmp(str, "idle") == 0) {
+		*result = IOPRIO_CLASS_IDLE;
+	} else {
+		LOG(LOG_WARNING, "Unknown I/O scheduling class '%s' (expected realtime, best-effort or idle).", str);
+		return -EINVAL;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// A list of CPUs, like taskset -c takes (f.g., 0,2-3)
+static int
+    parse_cpu_list(const char* str, uint64_t* result)
+{
+	uint64_t    mask = 0U;
+	const char* p    = str;
+
+	for (;;) {
+		char*         endptr;
+		unsigned long first = strtoul(p, &endptr, 10);
+		unsigned long last  = first;
+		if (endptr == p || *p == '-') {
+			break;
+		}
+		if (*endptr == '-') {
+			p    = endptr + 1;
+			last = strtoul(p, &endptr, 10);
+			if (endptr == p || *p == '-') {
+				break;
+			}
+		}
+		if (first > last || last >= 64U) {
+			LOG(LOG_WARNING, "Invalid CPU range in '%s' (only CPUs 0 to 63 are supported).", str);
+			return -EINVAL;
+		}
+		for (unsigned long cpu = first; cpu <= last; cpu++) {
+			mask |= (uint64_t) 1U << cpu;
+		}
+
+		if (*endptr == '\0') {
+			*result = mask;
+			return EXIT_SUCCESS;
+		} else if (*endptr != ',') {
+			break;
+		}
+		p = endptr + 1;
+	}
+
+	LOG(LOG_WARNING, "Assigned a malformed CPU list (%s) to a key expecting one (f.g., 0,2-3).", str);
+	return -EINVAL;
+}
+
+// An rlimit_* key: a value (in the resource's own unit), or unlimited. Returns -ENOENT if that's not an rlimit key.
+static int
+    parse_rlimit(const char* key, SpawnAttrs* attrs, const char* str)
+{
+	for (size_t i = 0U; i < sizeof(rlimit_keys) / sizeof(*rlimit_keys); i++) {
+		if (strcmp(key, rlimit_keys[i].key) != 0) {
+			continue;
+		}
+
+		rlim_t limit;
+		if (strcasecmp(str, "unlimited") == 0) {
+			limit = RLIM_INFINITY;
+		} else {
+			// NOTE: Same as strtoul_hu, we want to reject negative values.
+			char* endptr;
+			errno = 0;
+			limit = (rlim_t) strtoull(str, &endptr, 10);
+			if (strchr(str, '-') || endptr == str || *endptr != '\0' || errno != 0) {
+				LOG(LOG_WARNING, "Assigned an invalid value (%s) to %s (expected a number, or unlimited).", str, key);
+				return -EINVAL;
+			}
+		}
+
+		attrs->rlimits[rlimit_keys[i].resource].rlim_cur = limit;
+		attrs->rlimits[rlimit_keys[i].resource].rlim_max = limit;
+		attrs->rlimit_mask |= 1U << rlimit_keys[i].resource;
+		attrs->mask |= SPAWN_RLIMITS;
+		return EXIT_SUCCESS;
+	}
+
+	return -ENOENT;
+}
+
+// A cgroup path, relative to KFMON_CGROUP_ROOT, that can't escape from it
+static bool
+    is_cgroup_name_sane(const char* name)
+{
+	if (name[0] == '\0' || name[0] == '/') {
+		return false;
+	}
+	for (const char* p = name; *p != '\0';) {
+		size_t len = strcspn(p, "/");
+		if (len == 0U || (len == 1U && p[0] == '.') || (len == 2U && p[0] == '.' && p[1] == '.')) {
+			return false;
+		}
+		p += len;
+		if (*p == '/') {
+			p++;
+		}
+	}
+	return true;
+}
+
 // Handle parsing the main KFMon config
 static int
     daemon_handler(void* user, const char* section, const char* key, const char* value)
@@ -443,6 +1033,16 @@ static int
 			LOG(LOG_CRIT, "Passed an invalid value for with_notifications!");
 			return 0;
 		}
+	} else if (MATCH("daemon", "use_journal")) {
+		if (strtobool(value, &pconfig->use_journal) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for use_journal!");
+			return 0;
+		}
+	} else if (MATCH("daemon", "use_launcher")) {
+		if (strtobool(value, &pconfig->use_launcher) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for use_launcher!");
+			return 0;
+		}
 	} else {
 		return 0;    // unknown section/name, error
 	}
@@ -483,411 +1083,1927 @@ static int
 			LOG(LOG_CRIT, "Passed an invalid value for block_spawns!");
 			return 0;
 		}
-	} else if (MATCH("watch", "reboot_on_exit")) {
-		;
+	} else if (MATCH("watch", "debounce_ms")) {
+		if (strtoul_hu(value, &pconfig->debounce_ms) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for debounce_ms!");
+			return 0;
+		}
+	} else if (MATCH("watch", "nice")) {
+		if (strtol_i(value, -20, 19, &pconfig->spawn_attrs.nice) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for nice!");
+			return 0;
+		}
+		pconfig->spawn_attrs.mask |= SPAWN_NICE;
+	} else if (MATCH("watch", "sched_policy")) {
+		if (parse_sched_policy(value, &pconfig->spawn_attrs.sched_policy) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for sched_policy!");
+			return 0;
+		}
+		pconfig->spawn_attrs.mask |= SPAWN_SCHED;
+	} else if (MATCH("watch", "sched_priority")) {
+		if (strtol_i(value, 0, 99, &pconfig->spawn_attrs.sched_priority) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for sched_priority!");
+			return 0;
+		}
+	} else if (MATCH("watch", "ioprio_class")) {
+		if (parse_ioprio_class(value, &pconfig->spawn_attrs.ioprio_class) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for ioprio_class!");
+			return 0;
+		}
+		pconfig->spawn_attrs.mask |= SPAWN_IOPRIO;
+	} else if (MATCH("watch", "ioprio_level")) {
+		if (strtol_i(value, 0, 7, &pconfig->spawn_attrs.ioprio_level) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for ioprio_level!");
+			return 0;
+		}
+		pconfig->spawn_attrs.mask |= SPAWN_IOPRIO_LEVEL;
+	} else if (MATCH("watch", "cpu_affinity")) {
+		if (parse_cpu_list(value, &pconfig->spawn_attrs.cpu_affinity) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for cpu_affinity!");
+			return 0;
+		}
+		pconfig->spawn_attrs.mask |= SPAWN_CPU_AFFINITY;
+	} else if (MATCH("watch", "oom_score_adj")) {
+		if (strtol_i(value, -1000, 1000, &pconfig->spawn_attrs.oom_score_adj) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for oom_score_adj!");
+			return 0;
+		}
+		pconfig->spawn_attrs.mask |= SPAWN_OOM_SCORE_ADJ;
+	} else if (MATCH("watch", "cgroup")) {
+		if (!is_cgroup_name_sane(value) || strlen(value) >= sizeof(pconfig->spawn_attrs.cgroup)) {
+			LOG(LOG_CRIT, "Passed an invalid value for cgroup (it should be relative to %s)!", KFMON_CGROUP_ROOT);
+			return 0;
+		}
+		strncpy(pconfig->spawn_attrs.cgroup, value, sizeof(pconfig->spawn_attrs.cgroup) - 1U);    // Flawfinder: ignore
+		pconfig->spawn_attrs.mask |= SPAWN_CGROUP;
+	} else if (strcmp(section, "watch") == 0 && strncmp(key, "rlimit_", 7U) == 0) {
+		int ret = parse_rlimit(key, &pconfig->spawn_attrs, value);
+		if (ret == -ENOENT) {
+			return 0;    // unknown rlimit, error
+		} else if (ret < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for %s!", key);
+			return 0;
+		}
+	} else if (MATCH("watch", "reboot_on_exit")) {
+		;
 	} else {
 		return 0;    // unknown section/name, error
 	}
 	return 1;
 }
 
-// Validate a watch config
-static bool
-    validate_watch_config(void* user)
+// Append a new, zero-initialized watch to our registry, growing it if need be. Returns its index, or -1 on failure.
+static ssize_t
+    add_watch_config(void)
 {
-	WatchConfig* pconfig = (WatchConfig*) user;
-
-	bool sane = true;
-
-	if (pconfig->filename[0] == '\0') {
-		LOG(LOG_CRIT, "Mandatory key 'filename' is missing or blank!");
-		sane = false;
-	} else {
-		// Make sure we're not trying to set multiple watches on the same file...
-		// (because that would only actually register the first one parsed).
-		uint8_t matches = 0;
-		for (uint8_t watch_idx = 0; watch_idx < WATCH_MAX; watch_idx++) {
-			if (strcmp(pconfig->filename, watch_config[watch_idx].filename) == 0) {
-				matches++;
-			}
-		}
-		// Since we'll necessarily loop over ourselves, only warn if we matched two or more times.
-		if (matches >= 2) {
-			LOG(LOG_WARNING, "Tried to setup multiple watches on file '%s'!", pconfig->filename);
-			sane = false;
-		}
-	}
-	if (pconfig->action[0] == '\0') {
-		LOG(LOG_CRIT, "Mandatory key 'action' is missing or blank!");
-		sane = false;
+	// Recycle the slot of a watch we've retired on a config reload, if there's one that can't be referenced anymore
+	// (c.f., retire_watch_slot).
+	if (free_watch_count > 0U) {
+		size_t watch_idx = free_watch_slots[--free_watch_count];
+		memset(&watch_config[watch_idx], 0, sizeof(*watch_config));
+		watch_config[watch_idx].inotify_wd     = -1;
+		watch_config[watch_idx].parent_wd      = -1;
+		watch_config[watch_idx].spawn_pid      = -1;
+		watch_config[watch_idx].thumbnails.dfd = -1;
+		watch_config[watch_idx].thumbnails.wd  = -1;
+		return (ssize_t) watch_idx;
 	}
 
-	// If we asked for a database update, the next three keys become mandatory
-	if (pconfig->do_db_update) {
-		if (pconfig->db_title[0] == '\0') {
-			LOG(LOG_CRIT, "Mandatory key 'db_title' is missing or blank!");
-			sane = false;
+	if (watch_count >= watch_capacity) {
+		size_t       new_capacity = watch_capacity ? watch_capacity * 2U : 16U;
+		WatchConfig* new_config   = realloc(watch_config, new_capacity * sizeof(*new_config));
+		if (new_config == NULL) {
+			perror("[KFMon] [CRIT] realloc");
+			return -1;
 		}
-		if (pconfig->db_author[0] == '\0') {
-			LOG(LOG_CRIT, "Mandatory key 'db_author' is missing or blank!");
-			sane = false;
+		watch_config = new_config;
+		// NOTE: Every slot may end up retired, so make sure our free list can hold them all.
+		size_t* new_slots = realloc(free_watch_slots, new_capacity * sizeof(*new_slots));
+		if (new_slots == NULL) {
+			perror("[KFMon] [CRIT] realloc");
+			return -1;
 		}
-		if (pconfig->db_comment[0] == '\0') {
-			LOG(LOG_CRIT, "Mandatory key 'db_comment' is missing or blank!");
-			sane = false;
+		free_watch_slots = new_slots;
+		// Ditto for the ones we may be debouncing
+		new_slots = realloc(debouncing_watches, new_capacity * sizeof(*new_slots));
+		if (new_slots == NULL) {
+			perror("[KFMon] [CRIT] realloc");
+			return -1;
 		}
+		debouncing_watches = new_slots;
+		watch_capacity     = new_capacity;
 	}
 
-	return sane;
+	// NOTE: We rely on zero-initialization (c.f., watch_handler)
+	memset(&watch_config[watch_count], 0, sizeof(*watch_config));
+	watch_config[watch_count].inotify_wd     = -1;
+	watch_config[watch_count].parent_wd      = -1;
+	watch_config[watch_count].spawn_pid      = -1;
+	watch_config[watch_count].thumbnails.dfd = -1;
+	watch_config[watch_count].thumbnails.wd  = -1;
+
+	return (ssize_t) watch_count++;
 }
 
-// Load our config files...
-static int
-    load_config(void)
+// Flag a watch as retired, and make its slot available for recycling as soon as nothing can reference it anymore
+// NOTE: Our process table refers to watches by index, so a retired watch w/ a running spawn keeps its slot
+//       until that spawn is reaped (c.f., remove_process_from_table).
+static void
+    retire_watch_slot(size_t watch_idx)
 {
-	// Our config files live in the target mountpoint...
-	if (!is_target_mounted()) {
-		LOG(LOG_NOTICE, "%s isn't mounted, waiting for it to be . . .", KFMON_TARGET_MOUNTPOINT);
-		// If it's not, wait for it to be...
-		wait_for_target_mountpoint();
+	wlt_remove(&config_file_table, hash_filename(watch_config[watch_idx].config_file), watch_idx);
+	// NOTE: Its burst is moot now, and our debounce timer can't be left holding on to a slot we may recycle.
+	stop_debouncing(watch_idx);
+	watch_config[watch_idx].is_retired = true;
+	if (!is_watch_already_spawned(watch_idx)) {
+		free_watch_slots[free_watch_count++] = watch_idx;
 	}
+}
 
-	// Walk the config directory to pickup our ini files... (c.f.,
-	// https://keramida.wordpress.com/2009/07/05/fts3-or-avoiding-to-reinvent-the-wheel/)
-	FTS*    ftsp;
-	FTSENT* p;
-	FTSENT* chp;
-	// We only need to walk a single directory...
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunknown-pragmas"
-#pragma clang diagnostic ignored "-Wunknown-warning-option"
-#pragma GCC diagnostic ignored "-Wdiscarded-qualifiers"
-#pragma clang diagnostic ignored "-Wincompatible-pointer-types-discards-qualifiers"
-	char* const cfg_path[] = { KFMON_CONFIGPATH, NULL };
-#pragma GCC diagnostic pop
-	int ret;
-	int rval = 0;
+// Hash a target filename for our lookup table
+static size_t
+    hash_filename(const char* filename)
+{
+	// NOTE: We already have a perfectly serviceable string hash function at hand ;).
+	return (size_t) qhash((const unsigned char*) filename, strlen(filename));
+}
 
-	// Don't chdir (because that mountpoint can go buh-bye), and don't stat (because we don't need to).
-	if ((ftsp = fts_open(cfg_path, FTS_COMFOLLOW | FTS_LOGICAL | FTS_NOCHDIR | FTS_NOSTAT | FTS_XDEV, NULL)) ==
-	    NULL) {
-		perror("[KFMon] [CRIT] fts_open");
-		return -1;
+// Grow (or create) a lookup table so that it can hold at least n live entries, dropping deleted slots in the process
+static int
+    wlt_resize(WatchLookupTable* table, size_t n)
+{
+	// Keep the load factor under 50%
+	size_t new_capacity = 16U;
+	while (new_capacity < n * 2U) {
+		new_capacity *= 2U;
 	}
-	// Initialize ftsp with as many toplevel entries as possible.
-	chp = fts_children(ftsp, 0);
-	if (chp == NULL) {
-		// No files to traverse!
-		LOG(LOG_CRIT, "Config directory '%s' appears to be empty, aborting!", KFMON_CONFIGPATH);
-		fts_close(ftsp);
+
+	WatchLookupSlot* new_slots = calloc(new_capacity, sizeof(*new_slots));
+	if (new_slots == NULL) {
+		perror("[KFMon] [CRIT] calloc");
 		return -1;
 	}
-	while ((p = fts_read(ftsp)) != NULL) {
-		switch (p->fts_info) {
-			case FTS_F:
-				// Check if it's a .ini and not either an unix hidden file or a Mac resource fork...
-				if (p->fts_namelen > 4 &&
-				    strncasecmp(p->fts_name + (p->fts_namelen - 4), ".ini", 4) == 0 &&
-				    strncasecmp(p->fts_name, ".", 1) != 0) {
-					LOG(LOG_INFO, "Trying to load config file '%s' . . .", p->fts_path);
-					// The main config has to be parsed slightly differently...
-					if (strcasecmp(p->fts_name, "kfmon.ini") == 0) {
-						// NOTE: Can technically return -1 on file open error,
-						//       but that shouldn't really ever happen
-						//       given the nature of the loop we're in ;).
-						ret = ini_parse(p->fts_path, daemon_handler, &daemon_config);
-						if (ret != 0) {
-							LOG(LOG_CRIT,
-							    "Failed to parse main config file '%s' (first error on line %d), will abort!",
-							    p->fts_name,
-							    ret);
-							// Flag as a failure...
-							rval = -1;
-						} else {
-							LOG(LOG_NOTICE,
-							    "Daemon config loaded from '%s': db_timeout=%hu, use_syslog=%d, with_notifications=%d",
-							    p->fts_name,
-							    daemon_config.db_timeout,
-							    daemon_config.use_syslog,
-							    daemon_config.with_notifications);
-						}
-					} else {
-						// NOTE: Don't blow up when trying to store more watches than we have
-						//       space for...
-						if (watch_count >= WATCH_MAX) {
-							LOG(LOG_WARNING,
-							    "We've already setup the maximum amount of watches we can handle (%d), discarding '%s'!",
-							    WATCH_MAX,
-							    p->fts_name);
-							// Don't flag this as a hard failure, just warn and go on...
-							break;
-						}
-
-						ret = ini_parse(p->fts_path, watch_handler, &watch_config[watch_count]);
-						if (ret != 0) {
-							LOG(LOG_CRIT,
-							    "Failed to parse watch config file '%s' (first error on line %d), will abort!",
-							    p->fts_name,
-							    ret);
-							// Flag as a failure...
-							rval = -1;
-						} else {
-							if (validate_watch_config(&watch_config[watch_count])) {
-								LOG(LOG_NOTICE,
-								    "Watch config @ index %hhu loaded from '%s': filename=%s, action=%s, block_spawns=%d, do_db_update=%d, db_title=%s, db_author=%s, db_comment=%s",
-								    watch_count,
-								    p->fts_name,
-								    watch_config[watch_count].filename,
-								    watch_config[watch_count].action,
-								    watch_config[watch_count].block_spawns,
-								    watch_config[watch_count].do_db_update,
-								    watch_config[watch_count].db_title,
-								    watch_config[watch_count].db_author,
-								    watch_config[watch_count].db_comment);
-							} else {
-								LOG(LOG_CRIT,
-								    "Watch config file '%s' is not valid, will abort!",
-								    p->fts_name);
-								rval = -1;
-							}
-						}
-						// No matter what, switch to the next slot:
-						// we rely on zero-initialization (c.f., the comments around
-						// our strncpy() usage in watch_handler), so we can't reuse a slot,
-						// even in case of failure,
-						// or we risk mixing values from different config files together,
-						// which is why a broken watch config is flagged as a fatal failure.
-						watch_count++;
-					}
-				}
-				break;
-			default:
-				break;
+
+	size_t used = 0U;
+	for (size_t i = 0U; i < table->capacity; i++) {
+		WatchLookupSlot slot = table->slots[i];
+		if (slot.idx == WLT_EMPTY || slot.idx == WLT_DELETED) {
+			continue;
 		}
+		size_t j = slot.hash & (new_capacity - 1U);
+		while (new_slots[j].idx != WLT_EMPTY) {
+			j = (j + 1U) & (new_capacity - 1U);
+		}
+		new_slots[j] = slot;
+		used++;
 	}
-	fts_close(ftsp);
 
-#ifdef DEBUG
-	// Let's recap (including failures)...
-	DBGLOG("Daemon config recap: db_timeout=%hu, use_syslog=%d, with_notifications=%d",
-	       daemon_config.db_timeout,
-	       daemon_config.use_syslog,
-	       daemon_config.with_notifications);
-	for (uint8_t watch_idx = 0; watch_idx < watch_count; watch_idx++) {
-		DBGLOG(
-		    "Watch config @ index %hhu recap: filename=%s, action=%s, block_spawns=%d, skip_db_checks=%d, do_db_update=%d, db_title=%s, db_author=%s, db_comment=%s",
-		    watch_idx,
-		    watch_config[watch_idx].filename,
-		    watch_config[watch_idx].action,
-		    watch_config[watch_idx].block_spawns,
-		    watch_config[watch_idx].skip_db_checks,
-		    watch_config[watch_idx].do_db_update,
-		    watch_config[watch_idx].db_title,
-		    watch_config[watch_idx].db_author,
-		    watch_config[watch_idx].db_comment);
+	free(table->slots);
+	table->slots    = new_slots;
+	table->capacity = new_capacity;
+	table->used     = used;
+	return 0;
+}
+
+// Insert a watch in a lookup table, under the given hash
+static int
+    wlt_insert(WatchLookupTable* table, size_t hash, size_t watch_idx)
+{
+	if ((table->used + 1U) * 2U > table->capacity) {
+		if (wlt_resize(table, table->used + 1U) != 0) {
+			return -1;
+		}
 	}
-#endif
 
-	return rval;
+	size_t i = hash & (table->capacity - 1U);
+	while (table->slots[i].idx != WLT_EMPTY && table->slots[i].idx != WLT_DELETED) {
+		i = (i + 1U) & (table->capacity - 1U);
+	}
+	if (table->slots[i].idx == WLT_EMPTY) {
+		table->used++;
+	}
+	table->slots[i].hash = hash;
+	table->slots[i].idx  = watch_idx + 1U;
+	return 0;
 }
 
-// Implementation of Qt4's QtHash (c.f., qhash @
-// https://github.com/kovidgoyal/calibre/blob/master/src/calibre/devices/kobo/driver.py#L37)
-static unsigned int
-    qhash(const unsigned char* bytes, size_t length)
+// Remove a watch from a lookup table (it needs to have been inserted under the same hash)
+static void
+    wlt_remove(WatchLookupTable* table, size_t hash, size_t watch_idx)
 {
-	unsigned int h = 0;
+	if (table->capacity == 0U) {
+		return;
+	}
 
-	for (unsigned int i = 0; i < length; i++) {
-		h = (h << 4) + bytes[i];
-		h ^= (h & 0xf0000000) >> 23;
-		h &= 0x0fffffff;
+	for (size_t i = hash & (table->capacity - 1U); table->slots[i].idx != WLT_EMPTY;
+	     i     = (i + 1U) & (table->capacity - 1U)) {
+		if (table->slots[i].idx == watch_idx + 1U) {
+			// NOTE: Leave a tombstone, to avoid breaking the probe chain of whatever lives after us.
+			table->slots[i].idx = WLT_DELETED;
+			return;
+		}
 	}
+}
 
-	return h;
+// Forget everything a lookup table holds (but keep its storage around)
+static void
+    wlt_clear(WatchLookupTable* table)
+{
+	if (table->slots) {
+		memset(table->slots, 0, table->capacity * sizeof(*table->slots));
+	}
+	table->used = 0U;
 }
 
-// Check if our target file has been processed by Nickel...
-static bool
-    is_target_processed(uint8_t watch_idx, bool wait_for_db)
+// Walk every watch filed under a given hash in a lookup table, as several of them may share the same key
+// (f.g., the wd of a directory). cursor needs to start at 0, and -1 is returned once we're done.
+// NOTE: Removing entries while walking is fine (they're just tombstoned), inserting ones isn't.
+static ssize_t
+    wlt_find_next(const WatchLookupTable* table, size_t hash, size_t* cursor)
 {
-	sqlite3*      db;
-	sqlite3_stmt* stmt;
-	int           rc;
-	int           idx;
-	bool          is_processed = false;
-	bool          needs_update = false;
+	for (; *cursor < table->capacity; (*cursor)++) {
+		const WatchLookupSlot* slot = &table->slots[(hash + *cursor) & (table->capacity - 1U)];
+		if (slot->idx == WLT_EMPTY) {
+			break;
+		}
+		if (slot->idx != WLT_DELETED && slot->hash == hash) {
+			(*cursor)++;
+			return (ssize_t)(slot->idx - 1U);
+		}
+	}
 
-#ifdef DEBUG
-	// Bypass DB checks on demand for debugging purposes...
-	if (watch_config[watch_idx].skip_db_checks)
-		return true;
-#endif
+	*cursor = table->capacity;
+	return -1;
+}
 
-	// Did the user want to try to update the DB for this icon?
-	bool update = watch_config[watch_idx].do_db_update;
+// Find the watch idx an inotify watch descriptor belongs to (-1 if none)
+static ssize_t
+    find_watch_by_wd(int wd)
+{
+	if (wd_table.capacity == 0U || wd < 0) {
+		return -1;
+	}
 
-	// NOTE: Open the db in multi-thread threading mode (we build w/ threadsafe and we don't use sqlite_config),
-	//       and without a shared cache because we have no use for it, we only do SQL from the main thread.
-	if (update) {
-		CALL_SQLITE(open_v2(
-		    KOBO_DB_PATH, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_PRIVATECACHE, NULL));
-	} else {
-		// Open the DB ro to be extra-safe...
-		CALL_SQLITE(open_v2(
-		    KOBO_DB_PATH, &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_PRIVATECACHE, NULL));
+	// NOTE: wds are small sequential integers, so they make for a perfectly fine hash on their own.
+	for (size_t i = (size_t) wd & (wd_table.capacity - 1U); wd_table.slots[i].idx != WLT_EMPTY;
+	     i        = (i + 1U) & (wd_table.capacity - 1U)) {
+		size_t idx = wd_table.slots[i].idx;
+		if (idx != WLT_DELETED && watch_config[idx - 1U].inotify_wd == wd) {
+			return (ssize_t)(idx - 1U);
+		}
 	}
 
-	// Wait at most for Nms on OPEN & N*2ms on CLOSE if we ever hit a locked database during any of our proceedings.
-	// NOTE: The defaults timings (steps of 500ms) appear to work reasonably well on my H2O with a 50MB Nickel DB...
-	//       (i.e., it trips on OPEN when Nickel is moderately busy, but if everything's quiet, we're good).
-	//       Time will tell if that's a good middle-ground or not ;).
-	//       This is user configurable in kfmon.ini (db_timeout key).
-	// NOTE: On current FW versions, where the DB is now using WAL, we're exceedingly unlikely to ever hit a BUSY DB
-	//       (c.f., https://www.sqlite.org/wal.html)
-	sqlite3_busy_timeout(db, (int) daemon_config.db_timeout * (wait_for_db + 1));
-	DBGLOG("SQLite busy timeout set to %dms", (int) daemon_config.db_timeout * (wait_for_db + 1));
+	return -1;
+}
 
-	// NOTE: ContentType 6 should mean a book on pretty much anything since FW 1.9.17 (and why a book?
-	//       Because Nickel currently identifies single PNGs as application/x-cbz, bless its cute little bytes).
-	CALL_SQLITE(prepare_v2(
-	    db, "SELECT EXISTS(SELECT 1 FROM content WHERE ContentID = @id AND ContentType = '6');", -1, &stmt, NULL));
+// Find the watch idx for a given target filename (-1 if none)
+static ssize_t
+    find_watch_by_filename(const char* filename)
+{
+	if (filename_table.capacity == 0U) {
+		return -1;
+	}
 
-	// Append the proper URI scheme to our icon path...
-	char book_path[KFMON_PATH_MAX + 7];
-	snprintf(book_path, KFMON_PATH_MAX + 7, "file://%s", watch_config[watch_idx].filename);
+	size_t hash = hash_filename(filename);
+	for (size_t i = hash & (filename_table.capacity - 1U); filename_table.slots[i].idx != WLT_EMPTY;
+	     i        = (i + 1U) & (filename_table.capacity - 1U)) {
+		size_t idx = filename_table.slots[i].idx;
+		if (idx != WLT_DELETED && filename_table.slots[i].hash == hash &&
+		    strcmp(watch_config[idx - 1U].filename, filename) == 0) {
+			return (ssize_t)(idx - 1U);
+		}
+	}
 
-	idx = sqlite3_bind_parameter_index(stmt, "@id");
-	CALL_SQLITE(bind_text(stmt, idx, book_path, -1, SQLITE_STATIC));
+	return -1;
+}
 
-	rc = sqlite3_step(stmt);
-	if (rc == SQLITE_ROW) {
-		DBGLOG("SELECT SQL query returned: %d", sqlite3_column_int(stmt, 0));
-		if (sqlite3_column_int(stmt, 0) == 1) {
-			is_processed = true;
+// Find the (live) watch loaded from a given config file (-1 if none)
+static ssize_t
+    find_watch_by_config_file(const char* name)
+{
+	if (config_file_table.capacity == 0U) {
+		return -1;
+	}
+
+	size_t hash = hash_filename(name);
+	for (size_t i = hash & (config_file_table.capacity - 1U); config_file_table.slots[i].idx != WLT_EMPTY;
+	     i        = (i + 1U) & (config_file_table.capacity - 1U)) {
+		size_t idx = config_file_table.slots[i].idx;
+		if (idx != WLT_DELETED && config_file_table.slots[i].hash == hash &&
+		    strcmp(watch_config[idx - 1U].config_file, name) == 0) {
+			return (ssize_t)(idx - 1U);
 		}
 	}
 
-	sqlite3_finalize(stmt);
+	return -1;
+}
 
-	// Now that we know the book exists, we also want to check if the thumbnails do,
-	// to avoid getting triggered from the thumbnail creation...
-	// NOTE: Again, this assumes FW >= 2.9.0
-	if (is_processed) {
-		// Assume they haven't been processed until we can confirm it...
-		is_processed = false;
+// Update the inotify watch descriptor of a watch, keeping our wd lookup table in sync
+static void
+    set_watch_wd(size_t watch_idx, int wd)
+{
+	if (watch_config[watch_idx].inotify_wd != -1) {
+		wlt_remove(&wd_table, (size_t) watch_config[watch_idx].inotify_wd, watch_idx);
+	}
 
-		// We'll need the ImageID first...
-		CALL_SQLITE(prepare_v2(
-		    db, "SELECT ImageID FROM content WHERE ContentID = @id AND ContentType = '6';", -1, &stmt, NULL));
+	watch_config[watch_idx].inotify_wd = wd;
 
-		idx = sqlite3_bind_parameter_index(stmt, "@id");
-		CALL_SQLITE(bind_text(stmt, idx, book_path, -1, SQLITE_STATIC));
+	if (wd != -1) {
+		if (wlt_insert(&wd_table, (size_t) wd, watch_idx) != 0) {
+			LOG(LOG_ERR, "Failed to register wd %d in our lookup table, aborting!", wd);
+			notify("[KFMon] OOM ?!");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
 
-		rc = sqlite3_step(stmt);
-		if (rc == SQLITE_ROW) {
-			const unsigned char* image_id = sqlite3_column_text(stmt, 0);
-			size_t               len      = (size_t) sqlite3_column_bytes(stmt, 0);
-			DBGLOG("SELECT SQL query returned: %s", image_id);
-
-			// Then we need the proper hashes Nickel devises...
-			// c.f., images_path @
-			// https://github.com/kovidgoyal/calibre/blob/master/src/calibre/devices/kobo/driver.py#L2489
-			unsigned int hash = qhash(image_id, len);
-			unsigned int dir1 = hash & (0xff * 1);
-			unsigned int dir2 = (hash & (0xff00 * 1)) >> 8;
-
-			char images_path[KFMON_PATH_MAX];
-			snprintf(
-			    images_path, KFMON_PATH_MAX, "%s/.kobo-images/%u/%u", KFMON_TARGET_MOUNTPOINT, dir1, dir2);
-			DBGLOG("Checking for thumbnails in '%s' . . .", images_path);
-
-			// Count the number of processed thumbnails we find...
-			uint8_t thumbnails_count = 0;
-			char    thumbnail_path[KFMON_PATH_MAX];
-
-			// Start with the full-size screensaver...
-			snprintf(thumbnail_path, KFMON_PATH_MAX, "%s/%s - N3_FULL.parsed", images_path, image_id);
-			DBGLOG("Checking for full-size screensaver '%s' . . .", thumbnail_path);
-			if (access(thumbnail_path, F_OK) == 0) {
-				thumbnails_count++;
-			} else {
-				LOG(LOG_INFO, "Full-size screensaver hasn't been parsed yet!");
-			}
-
-			// Then the Homescreen tile...
-			// NOTE: This one might be a tad confusing...
-			//       If the icon has never been processed,
-			//       this will only happen the first time we *close* the PNG's "book"...
-			//       (i.e., the moment it pops up as the 'last opened' tile).
-			//       And *that* processing triggers a set of OPEN & CLOSE,
-			//       meaning we can quite possibly run on book *exit* that first time,
-			//       (and only that first time), if database locking permits...
-			snprintf(thumbnail_path, KFMON_PATH_MAX, "%s/%s - N3_LIBRARY_FULL.parsed", images_path, image_id);
-			DBGLOG("Checking for homescreen tile '%s' . . .", thumbnail_path);
-			if (access(thumbnail_path, F_OK) == 0) {
-				thumbnails_count++;
-			} else {
-				LOG(LOG_INFO, "Homescreen tile hasn't been parsed yet!");
-			}
+// Update the inotify watch descriptor on a watch's parent directory, keeping our lookup table in sync
+static void
+    set_parent_wd(size_t watch_idx, int wd)
+{
+	if (watch_config[watch_idx].parent_wd != -1) {
+		wlt_remove(&parent_wd_table, (size_t) watch_config[watch_idx].parent_wd, watch_idx);
+	}
 
-			// And finally the Library thumbnail...
-			snprintf(thumbnail_path, KFMON_PATH_MAX, "%s/%s - N3_LIBRARY_GRID.parsed", images_path, image_id);
-			DBGLOG("Checking for library thumbnail '%s' . . .", thumbnail_path);
-			if (access(thumbnail_path, F_OK) == 0) {
-				thumbnails_count++;
-			} else {
-				LOG(LOG_INFO, "Library thumbnail hasn't been parsed yet!");
-			}
+	watch_config[watch_idx].parent_wd = wd;
 
-			// Only give a greenlight if we got all three!
-			if (thumbnails_count == 3) {
-				is_processed = true;
-			}
+	if (wd != -1) {
+		if (wlt_insert(&parent_wd_table, (size_t) wd, watch_idx) != 0) {
+			LOG(LOG_ERR, "Failed to register wd %d in our lookup table, aborting!", wd);
+			notify("[KFMon] OOM ?!");
+			exit(EXIT_FAILURE);
 		}
+	}
+}
 
-		// NOTE: It's now safe to destroy the statement.
-		//       (We can't do that early in the success branch,
-		//       because we still hold a pointer to a result depending on the statement (image_id))
-		sqlite3_finalize(stmt);
+// Keep an eye on the directory holding a watch's target file, so that we know when the file gets (re)created
+static void
+    arm_parent_watch(int fd, size_t watch_idx)
+{
+	if (watch_config[watch_idx].parent_wd != -1) {
+		return;
 	}
 
-	// NOTE: Here be dragons!
-	//       This works in theory,
-	//       but risks confusing Nickel's handling of the DB if we do that when nickel is running (which we are).
-	//       Because doing it with Nickel running is a potentially terrible idea,
-	//       for various reasons (c.f., https://www.sqlite.org/howtocorrupt.html for the gory details,
-	//       some of which probably even apply here! :p).
-	//       As such, we leave enabling this option to the user's responsibility.
-	//       KOReader ships with it disabled.
-	//       The idea is to, optionally, update the Title, Author & Comment fields to make them more useful...
-	if (is_processed && update) {
-		// Check if the DB has already been updated by checking the title...
-		CALL_SQLITE(prepare_v2(
-		    db, "SELECT Title FROM content WHERE ContentID = @id AND ContentType = '6';", -1, &stmt, NULL));
+	char dir_path[KFMON_PATH_MAX];
+	snprintf(dir_path, sizeof(dir_path), "%s", watch_config[watch_idx].filename);
+	char* slash = strrchr(dir_path, '/');
+	if (slash == NULL) {
+		return;
+	}
+	// Don't chop the root directory off, just in case...
+	slash[slash == dir_path ? 1 : 0] = '\0';
+
+	// NOTE: Watching the same directory twice yields the same wd, and *replaces* its mask, hence IN_MASK_ADD,
+	//       in case it's one we're already watching for something else (f.g., our config directory).
+	int wd = inotify_add_watch(fd, dir_path, IN_CREATE | IN_MOVED_TO | IN_ONLYDIR | IN_MASK_ADD);
+	if (wd == -1) {
+		perror("[KFMon] [WARN] inotify_add_watch");
+	}
+	set_parent_wd(watch_idx, wd);
+}
 
-		idx = sqlite3_bind_parameter_index(stmt, "@id");
-		CALL_SQLITE(bind_text(stmt, idx, book_path, -1, SQLITE_STATIC));
+// Drop a watch's inotify watch on its parent directory
+static void
+    release_parent_watch(int fd, size_t watch_idx)
+{
+	int wd = watch_config[watch_idx].parent_wd;
+	if (wd == -1) {
+		return;
+	}
+	set_parent_wd(watch_idx, -1);
 
-		rc = sqlite3_step(stmt);
-		if (rc == SQLITE_ROW) {
-			DBGLOG("SELECT SQL query returned: %s", sqlite3_column_text(stmt, 0));
-			if (strcmp((const char*) sqlite3_column_text(stmt, 0), watch_config[watch_idx].db_title) != 0) {
-				needs_update = true;
-			}
+	// NOTE: Our targets tend to live in the same directory, so make sure nobody else still needs it...
+	//       (That includes our config directory watch, which would go down with it).
+	if (wd == config_wd) {
+		return;
+	}
+	size_t cursor = 0U;
+	if (wlt_find_next(&parent_wd_table, (size_t) wd, &cursor) != -1) {
+		return;
+	}
+	// NOTE: This queues an IN_IGNORED event for a wd we've already forgotten about, which handle_events skips.
+	//       It may also already be gone (f.g., on unmount), which is fine.
+	if (fd != -1 && inotify_rm_watch(fd, wd) == -1 && errno != EINVAL) {
+		perror("[KFMon] [WARN] inotify_rm_watch");
+	}
+}
+
+// Re-arm the watches whose target file just showed up in one of the directories we're keeping an eye on.
+// Returns false if the event wasn't for one of those.
+static bool
+    handle_parent_event(int fd, const struct inotify_event* event)
+{
+	if (event->wd < 0) {
+		return false;
+	}
+
+	bool    is_handled = false;
+	size_t  cursor     = 0U;
+	ssize_t found_idx;
+	while ((found_idx = wlt_find_next(&parent_wd_table, (size_t) event->wd, &cursor)) != -1) {
+		size_t       watch_idx = (size_t) found_idx;
+		WatchConfig* watch     = &watch_config[watch_idx];
+		is_handled             = true;
+
+		if (event->mask & IN_IGNORED) {
+			set_parent_wd(watch_idx, -1);
+			continue;
 		}
+		if (!event->len || !(event->mask & (IN_CREATE | IN_MOVED_TO)) || watch->is_retired ||
+		    watch->inotify_wd != -1) {
+			continue;
+		}
+		const char* name = strrchr(watch->filename, '/');
+		if (strcmp(name ? name + 1 : watch->filename, event->name) != 0) {
+			continue;
+		}
+		LOG(LOG_NOTICE, "'%s' just showed up, arming its watch @ index %zu", watch->filename, watch_idx);
+		arm_watch(fd, watch_idx);
+	}
+
+	return is_handled;
+}
 
-		sqlite3_finalize(stmt);
+// Flag a watch's target file for 'file was opened' and 'file was closed' events (c.f., arm_watches for the details)
+static void
+    arm_watch(int fd, size_t watch_idx)
+{
+	// Arm the parent watch *first*, so that the target file can't slip in between the two behind our back.
+	arm_parent_watch(fd, watch_idx);
+
+	int wd  = inotify_add_watch(fd, watch_config[watch_idx].filename, IN_OPEN | IN_CLOSE);
+	int err = errno;
+	set_watch_wd(watch_idx, wd);
+	if (wd != -1) {
+		LOG(LOG_NOTICE,
+		    "Setup an inotify watch for '%s' @ index %zu.",
+		    watch_config[watch_idx].filename,
+		    watch_idx);
+	} else if (err == ENOENT && watch_config[watch_idx].parent_wd != -1) {
+		// It'll get armed as soon as it shows up (c.f., handle_parent_event)
+		LOG(LOG_NOTICE,
+		    "'%s' doesn't exist (yet?), we'll arm its watch @ index %zu as soon as it does.",
+		    watch_config[watch_idx].filename,
+		    watch_idx);
+	} else {
+		errno = err;
+		perror("[KFMon] [WARN] inotify_add_watch");
+		LOG(LOG_WARNING, "Cannot watch '%s', discarding it!", watch_config[watch_idx].filename);
+		notify("[KFMon] Failed to watch %s!", basename(watch_config[watch_idx].filename));
+		// NOTE: We used to abort entirely in case even one target file couldn't be watched,
+		//       but that was a bit harsh ;).
+		//       Since the inotify watch couldn't be setup,
+		//       there's no way for this to cause trouble down the road,
+		//       and this allows the user to fix it during an USBMS session instead of having to reboot.
 	}
-	if (needs_update) {
-		CALL_SQLITE(prepare_v2(
-		    db,
-		    "UPDATE content SET Title = @title, Attribution = @author, Description = @comment WHERE ContentID = @id AND ContentType = '6';",
-		    -1,
-		    &stmt,
-		    NULL));
+}
 
-		// NOTE: No sanity checks are done to confirm that those watch configs are sane,
+// Forget about a watch whose config file is gone
+// NOTE: Its slot (and its config) is kept around as long as its spawn is still running,
+//       since our process table refers to it by index (c.f., add_watch_config).
+static void
+    retire_watch(int fd, size_t watch_idx)
+{
+	LOG(LOG_NOTICE,
+	    "Removing watch for '%s' @ index %zu (config file '%s' is gone)",
+	    watch_config[watch_idx].filename,
+	    watch_idx,
+	    watch_config[watch_idx].config_file);
+
+	// NOTE: This queues an IN_IGNORED event for a wd we'll have forgotten about by then, which handle_events skips.
+	if (fd != -1 && watch_config[watch_idx].inotify_wd != -1) {
+		if (inotify_rm_watch(fd, watch_config[watch_idx].inotify_wd) == -1) {
+			perror("[KFMon] [WARN] inotify_rm_watch");
+		}
+	}
+	set_watch_wd(watch_idx, -1);
+	wlt_remove(&filename_table, hash_filename(watch_config[watch_idx].filename), watch_idx);
+	reset_thumbnail_state(watch_idx);
+	watch_config[watch_idx].fingerprint.is_valid = false;
+	release_parent_watch(fd, watch_idx);
+	retire_watch_slot(watch_idx);
+}
+
+// Arm all of our watches, flagging each of our target files for 'file was opened' and 'file was closed' events
+// NOTE: We don't check for:
+//       IN_MODIFY: Highly unlikely (and sandwiched between an OPEN and a CLOSE anyway)
+//       IN_CREATE: Only applies to directories (we do watch our targets' directories for it, though,
+//           so that we can arm a watch as soon as its target file shows up (c.f., arm_parent_watch)).
+//       IN_DELETE: Only applies to directories
+//       IN_DELETE_SELF: Will trigger an IN_IGNORED, which we already handle (by re-arming that watch alone)
+//       IN_MOVE_SELF: Highly unlikely on a Kobo, and somewhat annoying to handle with our design
+//           (we'd have to forget about it entirely and not try to re-watch for it
+//           on the next iteration of the loop).
+// NOTE: inotify tracks the file's inode, which means that it goes *through* bind mounts, for instance:
+//           When bind-mounting file 'a' to file 'b', and setting up a watch to the path of file 'b',
+//           you won't get *any* event on that watch when unmounting that bind mount, since the original
+//           file 'a' hasn't actually been touched, and, as it is the actual, real file,
+//           that is what inotify is actually tracking.
+//       Relative to the earlier IN_MOVE_SELF mention, that means it'll keep tracking the file with its
+//           new name (provided it was moved to the *same* fs,
+//           as crossing a fs boundary will delete the original).
+static void
+    arm_watches(int fd)
+{
+	static bool is_first_pass = true;
+
+	// Our config files may have changed while we weren't looking (f.g., during an USBMS session)...
+	if (!is_first_pass || config_reload_requested) {
+		reload_configs(-1);
+	}
+	is_first_pass = false;
+
+	for (size_t watch_idx = 0U; watch_idx < watch_count; watch_idx++) {
+		if (!watch_config[watch_idx].is_retired) {
+			arm_watch(fd, watch_idx);
+		}
+	}
+	// And keep an eye on our config directory, to pick up config changes on the fly
+	// NOTE: Editors tend to write to a temporary file first, and then rename it over the original.
+	// NOTE: One of our targets may live in there, in which case arm_parent_watch already set this one up,
+	//       so make sure we don't clobber its mask (we'd lose its IN_CREATE).
+	config_wd = inotify_add_watch(
+	    fd, KFMON_CONFIGPATH, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_MASK_ADD);
+	if (config_wd == -1) {
+		perror("[KFMon] [WARN] inotify_add_watch");
+		LOG(LOG_WARNING,
+		    "Cannot watch config directory '%s', config changes will require a SIGHUP!",
+		    KFMON_CONFIGPATH);
+	} else {
+		LOG(LOG_NOTICE, "Setup an inotify watch for config directory '%s'.", KFMON_CONFIGPATH);
+	}
+
+	watches_mount_id = mount_state.mount_id;
+}
+
+// Tear down all our watches (and let go of everything we hold on the target mountpoint)
+// NOTE: Our inotify instance itself lives on, so that we can re-arm as soon as the target mountpoint is back.
+static void
+    disarm_watches(int fd)
+{
+	// Drop whatever we had on hold, that was for icons that might very well not be there anymore...
+	cancel_deferred_launches();
+	cancel_debounced_events();
+	// Let go of Nickel's DB, we'll reopen it on the first event after our watches are re-armed.
+	close_nickel_db();
+
+	for (size_t watch_idx = 0U; watch_idx < watch_count; watch_idx++) {
+		// NOTE: Those might have been destroyed by the kernel already (f.g., on unmount), which is fine.
+		if (watch_config[watch_idx].inotify_wd != -1) {
+			if (inotify_rm_watch(fd, watch_config[watch_idx].inotify_wd) == -1 && errno != EINVAL) {
+				perror("[KFMon] [WARN] inotify_rm_watch");
+			}
+		}
+		set_watch_wd(watch_idx, -1);
+		release_parent_watch(fd, watch_idx);
+		reset_thumbnail_state(watch_idx);
+	}
+	close_thumbnail_dirs();
+	if (config_wd != -1) {
+		if (inotify_rm_watch(fd, config_wd) == -1 && errno != EINVAL) {
+			perror("[KFMon] [WARN] inotify_rm_watch");
+		}
+		config_wd = -1;
+	}
+
+	watches_mount_id = -1;
+}
+
+// The mount table (may have) changed, see if that affects us
+// NOTE: This only acts on what actually changed since our watches were armed, so it's fine to call it speculatively.
+static void
+    handle_mount_change(int fd)
+{
+	refresh_mount_state();
+
+	if (!is_target_mounted()) {
+		// NOTE: We *need* to let go of everything on a lazy unmount (which is what happens when entering an USBMS
+		//       session), since our open DB connection would otherwise keep the fs alive behind the host's back...
+		if (watches_mount_id != -1) {
+			LOG(LOG_NOTICE, "%s was unmounted", KFMON_TARGET_MOUNTPOINT);
+			disarm_watches(fd);
+		}
+	} else if (watches_mount_id != mount_state.mount_id) {
+		// It's back (or it was remounted behind our back), and our watches need to follow it there
+		LOG(LOG_NOTICE, "%s is (re)mounted, re-arming our watches", KFMON_TARGET_MOUNTPOINT);
+		if (watches_mount_id != -1) {
+			disarm_watches(fd);
+		}
+		arm_watches(fd);
+	}
+}
+
+// We've lost some events (c.f., IN_Q_OVERFLOW), so we can't quite trust what we know about our watches anymore...
+// NOTE: Watching the same inode again yields the same wd, so only the watches that actually changed are affected.
+static void
+    resync_watches(int fd)
+{
+	// Make sure we didn't miss our target mountpoint going away (or coming back)
+	handle_mount_change(fd);
+	if (watches_mount_id == -1) {
+		return;
+	}
+
+	LOG(LOG_NOTICE, "Double-checking our watches, since we may have missed something . . .");
+	for (size_t watch_idx = 0U; watch_idx < watch_count; watch_idx++) {
+		if (watch_config[watch_idx].is_retired) {
+			continue;
+		}
+
+		int wd = watch_config[watch_idx].inotify_wd;
+		arm_watch(fd, watch_idx);
+		if (wd != -1 && wd != watch_config[watch_idx].inotify_wd) {
+			// Its target was replaced behind our back, make sure the kernel lets go of the stale watch, too.
+			if (inotify_rm_watch(fd, wd) == -1 && errno != EINVAL) {
+				perror("[KFMon] [WARN] inotify_rm_watch");
+			}
+			reset_thumbnail_state(watch_idx);
+		}
+		// And have the next check take an actual look at its thumbnails, instead of trusting what we were told
+		release_thumbnail_watch(watch_idx);
+	}
+	// We may have missed Nickel letting go of its DB
+	handle_db_wait(false);
+	// As well as changes to our configs
+	reload_configs(fd);
+}
+
+// Validate a watch config
+static bool
+    validate_watch_config(void* user)
+{
+	WatchConfig* pconfig = (WatchConfig*) user;
+
+	bool sane = true;
+
+	// NOTE: Whether that file is already watched is checked separately (c.f., claim_watch_filename),
+	//       since we may be validating a config that doesn't live in our registry (yet).
+	if (pconfig->filename[0] == '\0') {
+		LOG(LOG_CRIT, "Mandatory key 'filename' is missing or blank!");
+		sane = false;
+	}
+	if (pconfig->action[0] == '\0') {
+		LOG(LOG_CRIT, "Mandatory key 'action' is missing or blank!");
+		sane = false;
+	}
+
+	// Real-time policies need a priority, the others don't take one
+	const SpawnAttrs* attrs = &pconfig->spawn_attrs;
+	if (attrs->sched_priority != 0 &&
+	    (!(attrs->mask & SPAWN_SCHED) || (attrs->sched_policy != SCHED_FIFO && attrs->sched_policy != SCHED_RR))) {
+		LOG(LOG_CRIT, "Key 'sched_priority' only applies to the fifo & rr scheduling policies!");
+		sane = false;
+	}
+	if ((attrs->mask & SPAWN_SCHED) && (attrs->sched_policy == SCHED_FIFO || attrs->sched_policy == SCHED_RR) &&
+	    attrs->sched_priority == 0) {
+		LOG(LOG_CRIT, "Key 'sched_priority' is mandatory with the fifo & rr scheduling policies!");
+		sane = false;
+	}
+	if ((attrs->mask & SPAWN_IOPRIO_LEVEL) && !(attrs->mask & SPAWN_IOPRIO)) {
+		LOG(LOG_CRIT, "Key 'ioprio_level' requires 'ioprio_class'!");
+		sane = false;
+	}
+
+	// If we asked for a database update, the next three keys become mandatory
+	if (pconfig->do_db_update) {
+		if (pconfig->db_title[0] == '\0') {
+			LOG(LOG_CRIT, "Mandatory key 'db_title' is missing or blank!");
+			sane = false;
+		}
+		if (pconfig->db_author[0] == '\0') {
+			LOG(LOG_CRIT, "Mandatory key 'db_author' is missing or blank!");
+			sane = false;
+		}
+		if (pconfig->db_comment[0] == '\0') {
+			LOG(LOG_CRIT, "Mandatory key 'db_comment' is missing or blank!");
+			sane = false;
+		}
+	}
+
+	return sane;
+}
+
+// Register a watch's target file in our lookup table,
+// making sure we're not trying to set multiple watches on the same file...
+// (because that would only actually register the first one parsed).
+static bool
+    claim_watch_filename(size_t watch_idx)
+{
+	ssize_t match_idx = find_watch_by_filename(watch_config[watch_idx].filename);
+	if (match_idx != -1 && (size_t) match_idx != watch_idx) {
+		LOG(LOG_WARNING, "Tried to setup multiple watches on file '%s'!", watch_config[watch_idx].filename);
+		return false;
+	} else if (match_idx == -1) {
+		// First time we see it, remember it
+		if (wlt_insert(&filename_table, hash_filename(watch_config[watch_idx].filename), watch_idx) != 0) {
+			LOG(LOG_CRIT,
+			    "Failed to register file '%s' in our lookup table!",
+			    watch_config[watch_idx].filename);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Register a watch's config file in our lookup table, so that we can find it again on reload
+static bool
+    claim_watch_config_file(size_t watch_idx)
+{
+	if (wlt_insert(&config_file_table, hash_filename(watch_config[watch_idx].config_file), watch_idx) != 0) {
+		LOG(LOG_CRIT,
+		    "Failed to register config file '%s' in our lookup table!",
+		    watch_config[watch_idx].config_file);
+		return false;
+	}
+
+	return true;
+}
+
+// Check if it's a .ini and not either an unix hidden file or a Mac resource fork...
+static bool
+    is_config_filename(const char* name)
+{
+	size_t len = strlen(name);
+	return len > 4 && strncasecmp(name + (len - 4), ".ini", 4) == 0 && strncasecmp(name, ".", 1) != 0;
+}
+
+// Load our config files...
+static int
+    load_config(void)
+{
+	// Our config files live in the target mountpoint...
+	if (!is_target_mounted()) {
+		LOG(LOG_NOTICE, "%s isn't mounted, waiting for it to be . . .", KFMON_TARGET_MOUNTPOINT);
+		// If it's not, wait for it to be...
+		wait_for_target_mountpoint();
+	}
+
+	// Take stock of our config directory first, because if nothing changed since last time,
+	// we can skip parsing it entirely, and load the snapshot we made of the result instead.
+	// (Being spared a bunch of small reads on a FAT32 partition Nickel is busy hammering is always welcome).
+	struct timespec     ts;
+	ConfigSnapshotFile* files      = NULL;
+	size_t              file_count = 0U;
+	uint64_t            parse_us   = 0U;
+	get_monotonic_time(&ts);
+	if (scan_config_dir(&files, &file_count) != 0) {
+		LOG(LOG_CRIT, "Cannot scan config directory '%s', aborting!", KFMON_CONFIGPATH);
+		return -1;
+	}
+	if (load_config_snapshot(files, file_count, &parse_us)) {
+		uint64_t load_us = get_elapsed_us(&ts);
+		LOG(LOG_NOTICE,
+		    "Loaded %zu watches from config snapshot '%s' in %lluus, saving %lldus over a full parse (%lluus)",
+		    watch_count,
+		    KFMON_CONFIG_SNAPSHOT,
+		    (unsigned long long) load_us,
+		    (long long) parse_us - (long long) load_us,
+		    (unsigned long long) parse_us);
+		// Keep it around, so that reload_configs knows what actually changed
+		config_files      = files;
+		config_file_count = file_count;
+		return 0;
+	}
+
+	// Parse exactly the files we've just taken stock of, so that the snapshot's key always matches its contents.
+	if (file_count == 0U) {
+		LOG(LOG_CRIT, "Config directory '%s' appears to be empty, aborting!", KFMON_CONFIGPATH);
+		free(files);
+		return -1;
+	}
+	int ret;
+	int rval = 0;
+	for (size_t i = 0U; i < file_count; i++) {
+		char path[KFMON_PATH_MAX];
+		snprintf(path, sizeof(path), "%s/%s", KFMON_CONFIGPATH, files[i].name);
+		LOG(LOG_INFO, "Trying to load config file '%s' . . .", path);
+		// The main config has to be parsed slightly differently...
+		if (strcasecmp(files[i].name, "kfmon.ini") == 0) {
+			// NOTE: Can technically return -1 on file open error,
+			//       but that shouldn't really ever happen
+			//       given the nature of the loop we're in ;).
+			ret = ini_parse(path, daemon_handler, &daemon_config);
+			if (ret != 0) {
+				LOG(LOG_CRIT,
+				    "Failed to parse main config file '%s' (first error on line %d), will abort!",
+				    files[i].name,
+				    ret);
+				// Flag as a failure...
+				rval = -1;
+			} else {
+				LOG(LOG_NOTICE,
+				    "Daemon config loaded from '%s': db_timeout=%hu, use_syslog=%d, with_notifications=%d, use_journal=%d, use_launcher=%d",
+				    files[i].name,
+				    daemon_config.db_timeout,
+				    daemon_config.use_syslog,
+				    daemon_config.with_notifications,
+				    daemon_config.use_journal,
+				    daemon_config.use_launcher);
+			}
+		} else {
+			// Make room for a new watch in our registry...
+			ssize_t new_idx = add_watch_config();
+			if (new_idx == -1) {
+				LOG(LOG_CRIT,
+				    "Failed to make room for a new watch, discarding '%s', will abort!",
+				    files[i].name);
+				rval = -1;
+				continue;
+			}
+
+			ret = ini_parse(path, watch_handler, &watch_config[new_idx]);
+			if (ret != 0) {
+				LOG(LOG_CRIT,
+				    "Failed to parse watch config file '%s' (first error on line %d), will abort!",
+				    files[i].name,
+				    ret);
+				// Flag as a failure...
+				rval = -1;
+			} else {
+				// Remember where it came from, so we can reload it later
+				strncpy(watch_config[new_idx].config_file,
+					files[i].name,
+					sizeof(watch_config[new_idx].config_file) - 1U);    // Flawfinder: ignore
+				if (validate_watch_config(&watch_config[new_idx]) &&
+				    claim_watch_filename((size_t) new_idx) &&
+				    claim_watch_config_file((size_t) new_idx)) {
+					LOG(LOG_NOTICE,
+					    "Watch config @ index %zd loaded from '%s': filename=%s, action=%s, block_spawns=%d, debounce_ms=%hu, do_db_update=%d, db_title=%s, db_author=%s, db_comment=%s",
+					    new_idx,
+					    files[i].name,
+					    watch_config[new_idx].filename,
+					    watch_config[new_idx].action,
+					    watch_config[new_idx].block_spawns,
+					    watch_config[new_idx].debounce_ms,
+					    watch_config[new_idx].do_db_update,
+					    watch_config[new_idx].db_title,
+					    watch_config[new_idx].db_author,
+					    watch_config[new_idx].db_comment);
+				} else {
+					LOG(LOG_CRIT,
+					    "Watch config file '%s' is not valid, will abort!",
+					    files[i].name);
+					rval = -1;
+				}
+			}
+			// NOTE: No matter what, we've switched to a new slot:
+			//       we rely on zero-initialization (c.f., the comments around
+			//       our strncpy() usage in watch_handler), so we can't reuse a slot,
+			//       even in case of failure,
+			//       or we risk mixing values from different config files together,
+			//       which is why a broken watch config is flagged as a fatal failure.
+		}
+	}
+
+	// Snapshot the result, so that we can skip all that on the next boot
+	if (rval == 0) {
+		parse_us = get_elapsed_us(&ts);
+		LOG(LOG_INFO, "Parsed our config files in %lluus", (unsigned long long) parse_us);
+		save_config_snapshot(files, file_count, parse_us);
+	}
+	config_files      = files;
+	config_file_count = file_count;
+
+#ifdef DEBUG
+	// Let's recap (including failures)...
+	DBGLOG("Daemon config recap: db_timeout=%hu, use_syslog=%d, with_notifications=%d",
+	       daemon_config.db_timeout,
+	       daemon_config.use_syslog,
+	       daemon_config.with_notifications);
+	for (size_t watch_idx = 0; watch_idx < watch_count; watch_idx++) {
+		char spawn_attrs[256];
+		format_spawn_attrs(&watch_config[watch_idx].spawn_attrs, spawn_attrs, sizeof(spawn_attrs));
+		DBGLOG(
+		    "Watch config @ index %zu recap: filename=%s, action=%s, block_spawns=%d, debounce_ms=%hu, skip_db_checks=%d, do_db_update=%d, db_title=%s, db_author=%s, db_comment=%s, spawn_attrs=%s",
+		    watch_idx,
+		    watch_config[watch_idx].filename,
+		    watch_config[watch_idx].action,
+		    watch_config[watch_idx].block_spawns,
+		    watch_config[watch_idx].debounce_ms,
+		    watch_config[watch_idx].skip_db_checks,
+		    watch_config[watch_idx].do_db_update,
+		    watch_config[watch_idx].db_title,
+		    watch_config[watch_idx].db_author,
+		    watch_config[watch_idx].db_comment,
+		    spawn_attrs);
+	}
+#endif
+
+	return rval;
+}
+
+// List the config files in our config directory, along with their size & mtime, to know if our snapshot is stale.
+// NOTE: This is *the* list of config files we load (both at boot and on reload): only the toplevel counts,
+//       as that's all our config directory watch ever sees, and that's also how config files are keyed
+//       (c.f., WatchConfig's config_file).
+static int
+    scan_config_dir(ConfigSnapshotFile** files, size_t* file_count)
+{
+	DIR* dir = opendir(KFMON_CONFIGPATH);
+	if (dir == NULL) {
+		perror("[KFMon] [WARN] opendir");
+		return -1;
+	}
+
+	ConfigSnapshotFile*  list     = NULL;
+	size_t               count    = 0U;
+	size_t               capacity = 0U;
+	const struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (!is_config_filename(entry->d_name)) {
+			continue;
+		}
+		struct stat st;
+		if (fstatat(dirfd(dir), entry->d_name, &st, 0) == -1 || !S_ISREG(st.st_mode)) {
+			continue;
+		}
+
+		if (count >= capacity) {
+			size_t              new_capacity = capacity ? capacity * 2U : 16U;
+			ConfigSnapshotFile* new_list     = realloc(list, new_capacity * sizeof(*new_list));
+			if (new_list == NULL) {
+				perror("[KFMon] [WARN] realloc");
+				free(list);
+				closedir(dir);
+				return -1;
+			}
+			list     = new_list;
+			capacity = new_capacity;
+		}
+		// NOTE: Zero-init to avoid writing uninitialized bytes to disk
+		memset(&list[count], 0, sizeof(*list));
+		snprintf(list[count].name, sizeof(list[count].name), "%s", entry->d_name);
+		list[count].size  = (int64_t) st.st_size;
+		list[count].mtime = (int64_t) st.st_mtim.tv_sec * 1000000000 + (int64_t) st.st_mtim.tv_nsec;
+		count++;
+	}
+	closedir(dir);
+
+	// Keep it sorted, so we can bsearch it
+	if (count > 1U) {
+		qsort(list, count, sizeof(*list), compare_config_files);
+	}
+	*files      = list;
+	*file_count = count;
+	return 0;
+}
+
+static int
+    compare_config_files(const void* a, const void* b)
+{
+	const ConfigSnapshotFile* file_a = a;
+	const ConfigSnapshotFile* file_b = b;
+	return strncmp(file_a->name, file_b->name, sizeof(file_a->name));
+}
+
+// Look a config file up by name in a list built by scan_config_dir
+static const ConfigSnapshotFile*
+    find_config_file(const ConfigSnapshotFile* files, size_t file_count, const char* name)
+{
+	if (file_count == 0U) {
+		return NULL;
+	}
+	ConfigSnapshotFile key;
+	snprintf(key.name, sizeof(key.name), "%s", name);
+	return bsearch(&key, files, file_count, sizeof(*files), compare_config_files);
+}
+
+// Update what we know about a config file we've just reloaded on the fly, so that reload_configs won't do it again
+static void
+    refresh_config_file(const char* name)
+{
+	char path[KFMON_PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%s", KFMON_CONFIGPATH, name);
+	struct stat st;
+	if (stat(path, &st) == -1 || !S_ISREG(st.st_mode)) {
+		// NOTE: If it's gone, its watch is already gone, too; the next reload_configs will forget about it.
+		return;
+	}
+
+	// Find it, or where it would go, so as to keep the list sorted
+	size_t lo = 0U;
+	size_t hi = config_file_count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2U;
+		int    cmp = strncmp(config_files[mid].name, name, sizeof(config_files[mid].name));
+		if (cmp == 0) {
+			lo = hi = mid;
+			break;
+		}
+		if (cmp < 0) {
+			lo = mid + 1U;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo == config_file_count || strncmp(config_files[lo].name, name, sizeof(config_files[lo].name)) != 0) {
+		// It's a new one
+		ConfigSnapshotFile* new_list = realloc(config_files, (config_file_count + 1U) * sizeof(*new_list));
+		if (new_list == NULL) {
+			perror("[KFMon] [WARN] realloc");
+			return;
+		}
+		config_files = new_list;
+		memmove(&config_files[lo + 1U], &config_files[lo], (config_file_count - lo) * sizeof(*config_files));
+		config_file_count++;
+		memset(&config_files[lo], 0, sizeof(*config_files));
+		snprintf(config_files[lo].name, sizeof(config_files[lo].name), "%s", name);
+	}
+	config_files[lo].size  = (int64_t) st.st_size;
+	config_files[lo].mtime = (int64_t) st.st_mtim.tv_sec * 1000000000 + (int64_t) st.st_mtim.tv_nsec;
+}
+
+// Load our config from the snapshot we made the last time we parsed it, provided it's still up to date
+static bool
+    load_config_snapshot(const ConfigSnapshotFile* files, size_t file_count, uint64_t* parse_us)
+{
+	FILE* f = fopen(KFMON_CONFIG_SNAPSHOT, "re");
+	if (!f) {
+		if (errno != ENOENT) {
+			perror("[KFMon] [WARN] fopen");
+		}
+		LOG(LOG_INFO, "No config snapshot to load");
+		return false;
+	}
+
+	ConfigSnapshotHeader header;
+	if (fread(&header, sizeof(header), 1U, f) != 1U ||
+	    memcmp(header.magic, KFMON_CONFIG_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+	    header.version != KFMON_CONFIG_SNAPSHOT_VERSION) {
+		LOG(LOG_WARNING, "Config snapshot '%s' is invalid or outdated, ignoring it", KFMON_CONFIG_SNAPSHOT);
+		fclose(f);
+		return false;
+	}
+	if (header.file_count != file_count) {
+		LOG(LOG_INFO, "Config snapshot is stale (config files were added or removed)");
+		fclose(f);
+		return false;
+	}
+
+	// Make sure every single one of our config files is exactly as it was when we made the snapshot
+	ConfigSnapshotFile file;
+	for (uint32_t i = 0U; i < header.file_count; i++) {
+		if (fread(&file, sizeof(file), 1U, f) != 1U) {
+			LOG(LOG_WARNING, "Config snapshot '%s' is truncated", KFMON_CONFIG_SNAPSHOT);
+			fclose(f);
+			return false;
+		}
+		file.name[sizeof(file.name) - 1U] = '\0';
+		const ConfigSnapshotFile* match = find_config_file(files, file_count, file.name);
+		if (!match || match->size != file.size || match->mtime != file.mtime) {
+			LOG(LOG_INFO, "Config snapshot is stale ('%s' was modified or removed)", file.name);
+			fclose(f);
+			return false;
+		}
+	}
+
+	// It's up to date, slurp the watches in one go, so we don't leave a half-loaded registry behind on failure.
+	ConfigSnapshotWatch* watches = calloc(MAX(header.watch_count, 1U), sizeof(*watches));
+	if (watches == NULL) {
+		perror("[KFMon] [WARN] calloc");
+		fclose(f);
+		return false;
+	}
+	if (fread(watches, sizeof(*watches), header.watch_count, f) != header.watch_count) {
+		LOG(LOG_WARNING, "Config snapshot '%s' is truncated", KFMON_CONFIG_SNAPSHOT);
+		free(watches);
+		fclose(f);
+		return false;
+	}
+	fclose(f);
+
+	daemon_config = header.daemon;
+	LOG(LOG_NOTICE,
+	    "Daemon config loaded from snapshot: db_timeout=%hu, use_syslog=%d, with_notifications=%d, use_journal=%d, use_launcher=%d",
+	    daemon_config.db_timeout,
+	    daemon_config.use_syslog,
+	    daemon_config.with_notifications,
+	    daemon_config.use_journal,
+	    daemon_config.use_launcher);
+	for (uint32_t i = 0U; i < header.watch_count; i++) {
+		ssize_t new_idx = add_watch_config();
+		if (new_idx == -1) {
+			break;
+		}
+		WatchConfig*               watch  = &watch_config[new_idx];
+		const ConfigSnapshotWatch* record = &watches[i];
+		// Make sure we won't run off into the weeds...
+		memcpy(watch->filename, record->filename, sizeof(watch->filename) - 1U);
+		memcpy(watch->action, record->action, sizeof(watch->action) - 1U);
+		memcpy(watch->db_title, record->db_title, sizeof(watch->db_title) - 1U);
+		memcpy(watch->db_author, record->db_author, sizeof(watch->db_author) - 1U);
+		memcpy(watch->db_comment, record->db_comment, sizeof(watch->db_comment) - 1U);
+		memcpy(watch->config_file, record->config_file, sizeof(watch->config_file) - 1U);
+		watch->skip_db_checks = record->skip_db_checks;
+		watch->do_db_update   = record->do_db_update;
+		watch->block_spawns   = record->block_spawns;
+		watch->debounce_ms    = record->debounce_ms;
+		watch->spawn_attrs    = record->spawn_attrs;
+		watch->spawn_attrs.cgroup[sizeof(watch->spawn_attrs.cgroup) - 1U] = '\0';
+		if (!claim_watch_filename((size_t) new_idx) || !claim_watch_config_file((size_t) new_idx)) {
+			break;
+		}
+		LOG(LOG_INFO,
+		    "Watch config @ index %zd loaded from snapshot of '%s': filename=%s, action=%s, block_spawns=%d, debounce_ms=%hu, do_db_update=%d, db_title=%s, db_author=%s, db_comment=%s",
+		    new_idx,
+		    watch->config_file,
+		    watch->filename,
+		    watch->action,
+		    watch->block_spawns,
+		    watch->debounce_ms,
+		    watch->do_db_update,
+		    watch->db_title,
+		    watch->db_author,
+		    watch->db_comment);
+	}
+	free(watches);
+	if (watch_count != header.watch_count) {
+		// Start from scratch, the full parse will tell us what went wrong
+		LOG(LOG_WARNING, "Failed to load our watches from config snapshot '%s'", KFMON_CONFIG_SNAPSHOT);
+		wlt_clear(&filename_table);
+		watch_count = 0U;
+		return false;
+	}
+
+	*parse_us = header.parse_us;
+	return true;
+}
+
+// Snapshot our freshly parsed config, atomically, along with the state of the config directory it came from
+static void
+    save_config_snapshot(const ConfigSnapshotFile* files, size_t file_count, uint64_t parse_us)
+{
+	char tmp_path[] = KFMON_CONFIG_SNAPSHOT ".tmp";
+	int  fd         = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd == -1) {
+		perror("[KFMon] [WARN] open");
+		return;
+	}
+	FILE* f = fdopen(fd, "w");
+	if (!f) {
+		perror("[KFMon] [WARN] fdopen");
+		close(fd);
+		unlink(tmp_path);
+		return;
+	}
+
+	// NOTE: Zero-init to avoid writing uninitialized padding bytes to disk
+	ConfigSnapshotHeader header = { 0 };
+	memcpy(header.magic, KFMON_CONFIG_SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version     = KFMON_CONFIG_SNAPSHOT_VERSION;
+	header.file_count  = (uint32_t) file_count;
+	header.watch_count = (uint32_t) watch_count;
+	header.parse_us    = parse_us;
+	header.daemon      = daemon_config;
+
+	bool ok = (fwrite(&header, sizeof(header), 1U, f) == 1U);
+	ok      = ok && (fwrite(files, sizeof(*files), file_count, f) == file_count);
+	for (size_t watch_idx = 0; ok && watch_idx < watch_count; watch_idx++) {
+		const WatchConfig*  watch  = &watch_config[watch_idx];
+		ConfigSnapshotWatch record = { 0 };
+		// NOTE: Both sides are the same size, and the source is zero-padded (c.f., watch_handler)
+		memcpy(record.filename, watch->filename, sizeof(record.filename));
+		memcpy(record.action, watch->action, sizeof(record.action));
+		memcpy(record.db_title, watch->db_title, sizeof(record.db_title));
+		memcpy(record.db_author, watch->db_author, sizeof(record.db_author));
+		memcpy(record.db_comment, watch->db_comment, sizeof(record.db_comment));
+		memcpy(record.config_file, watch->config_file, sizeof(record.config_file));
+		record.skip_db_checks = watch->skip_db_checks;
+		record.do_db_update   = watch->do_db_update;
+		record.block_spawns   = watch->block_spawns;
+		record.debounce_ms    = watch->debounce_ms;
+		record.spawn_attrs    = watch->spawn_attrs;
+		ok                    = (fwrite(&record, sizeof(record), 1U, f) == 1U);
+	}
+	if (fflush(f) != 0 || fsync(fd) != 0) {
+		ok = false;
+	}
+	fclose(f);
+
+	if (!ok || rename(tmp_path, KFMON_CONFIG_SNAPSHOT) != 0) {
+		LOG(LOG_WARNING, "Failed to write config snapshot to '%s'", KFMON_CONFIG_SNAPSHOT);
+		unlink(tmp_path);
+	}
+}
+
+// Copy a freshly parsed watch config over a live one, leaving its runtime state alone
+static void
+    update_watch_config(size_t watch_idx, const WatchConfig* pconfig)
+{
+	WatchConfig* watch = &watch_config[watch_idx];
+
+	memcpy(watch->filename, pconfig->filename, sizeof(watch->filename));
+	memcpy(watch->action, pconfig->action, sizeof(watch->action));
+	memcpy(watch->db_title, pconfig->db_title, sizeof(watch->db_title));
+	memcpy(watch->db_author, pconfig->db_author, sizeof(watch->db_author));
+	memcpy(watch->db_comment, pconfig->db_comment, sizeof(watch->db_comment));
+	memcpy(watch->config_file, pconfig->config_file, sizeof(watch->config_file));
+	watch->skip_db_checks = pconfig->skip_db_checks;
+	watch->do_db_update   = pconfig->do_db_update;
+	watch->block_spawns   = pconfig->block_spawns;
+	watch->debounce_ms    = pconfig->debounce_ms;
+	watch->spawn_attrs    = pconfig->spawn_attrs;
+}
+
+// Apply what we can of a modified main config on the fly
+static void
+    reload_daemon_config(const char* path)
+{
+	DaemonConfig new_config = { 0 };
+	int          ret        = ini_parse(path, daemon_handler, &new_config);
+	if (ret != 0) {
+		LOG(LOG_ERR,
+		    "Failed to parse main config file '%s' (first error on line %d), keeping the current one!",
+		    path,
+		    ret);
+		return;
+	}
+
+	// NOTE: These are only honored at boot (they're tied to fds we set up once and for all).
+	if (new_config.use_syslog != daemon_config.use_syslog || new_config.use_journal != daemon_config.use_journal ||
+	    new_config.use_launcher != daemon_config.use_launcher) {
+		LOG(LOG_WARNING,
+		    "Changes to use_syslog, use_journal or use_launcher will only be honored after a restart");
+	}
+	daemon_config.db_timeout         = new_config.db_timeout;
+	daemon_config.with_notifications = new_config.with_notifications;
+	LOG(LOG_NOTICE,
+	    "Daemon config reloaded: db_timeout=%hu, with_notifications=%d",
+	    daemon_config.db_timeout,
+	    daemon_config.with_notifications);
+}
+
+// Reload a single config file, and only touch the inotify watch it's responsible for (if need be).
+// NOTE: fd may be -1, in which case our caller will take care of (re-)arming our watches itself.
+static void
+    reload_config_file(int fd, const char* name)
+{
+	char path[KFMON_PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%s", KFMON_CONFIGPATH, name);
+
+	if (strcasecmp(name, "kfmon.ini") == 0) {
+		reload_daemon_config(path);
+		return;
+	}
+
+	// Find the watch it used to describe, if any
+	ssize_t watch_idx = find_watch_by_config_file(name);
+
+	// NOTE: We rely on zero-initialization (c.f., watch_handler)
+	WatchConfig new_config;
+	memset(&new_config, 0, sizeof(new_config));
+	strncpy(new_config.config_file, name, sizeof(new_config.config_file) - 1U);    // Flawfinder: ignore
+	int ret = ini_parse(path, watch_handler, &new_config);
+	if (ret == -1) {
+		// It's gone (deleted, or renamed to something else)
+		if (watch_idx != -1) {
+			retire_watch(fd, (size_t) watch_idx);
+		}
+		return;
+	}
+	// NOTE: Unlike at boot, a broken config isn't fatal: we just keep what we had, if anything.
+	if (ret != 0) {
+		LOG(LOG_ERR, "Failed to parse watch config file '%s' (first error on line %d), ignoring it!", name, ret);
+		return;
+	}
+	if (!validate_watch_config(&new_config)) {
+		LOG(LOG_ERR, "Watch config file '%s' is not valid, ignoring it!", name);
+		return;
+	}
+
+	// Make sure we're not trying to set multiple watches on the same file...
+	ssize_t match_idx = find_watch_by_filename(new_config.filename);
+	if (match_idx != -1 && match_idx != watch_idx) {
+		LOG(LOG_WARNING,
+		    "Tried to setup multiple watches on file '%s' (from '%s'), ignoring it!",
+		    new_config.filename,
+		    name);
+		return;
+	}
+
+	if (watch_idx == -1) {
+		// Brand new watch
+		watch_idx = add_watch_config();
+		if (watch_idx == -1 || grow_process_table(watch_count) != 0) {
+			LOG(LOG_ERR, "Failed to make room for a new watch, discarding '%s'!", name);
+			if (watch_idx != -1) {
+				retire_watch_slot((size_t) watch_idx);
+			}
+			return;
+		}
+		update_watch_config((size_t) watch_idx, &new_config);
+		if (!claim_watch_filename((size_t) watch_idx)) {
+			retire_watch_slot((size_t) watch_idx);
+			return;
+		}
+		if (!claim_watch_config_file((size_t) watch_idx)) {
+			wlt_remove(&filename_table, hash_filename(watch_config[watch_idx].filename), (size_t) watch_idx);
+			retire_watch_slot((size_t) watch_idx);
+			return;
+		}
+		LOG(LOG_NOTICE, "New watch config @ index %zd loaded from '%s'", watch_idx, name);
+		if (fd != -1) {
+			arm_watch(fd, (size_t) watch_idx);
+		}
+	} else if (strcmp(new_config.filename, watch_config[watch_idx].filename) != 0) {
+		// Its target changed, so it needs a new inotify watch
+		LOG(LOG_NOTICE,
+		    "Watch config @ index %zd reloaded from '%s': target changed from '%s' to '%s'",
+		    watch_idx,
+		    name,
+		    watch_config[watch_idx].filename,
+		    new_config.filename);
+		if (fd != -1 && watch_config[watch_idx].inotify_wd != -1) {
+			if (inotify_rm_watch(fd, watch_config[watch_idx].inotify_wd) == -1) {
+				perror("[KFMon] [WARN] inotify_rm_watch");
+			}
+		}
+		set_watch_wd((size_t) watch_idx, -1);
+		release_parent_watch(fd, (size_t) watch_idx);
+		wlt_remove(&filename_table, hash_filename(watch_config[watch_idx].filename), (size_t) watch_idx);
+		update_watch_config((size_t) watch_idx, &new_config);
+		// We know nothing about that new target yet
+		watch_config[watch_idx].fingerprint.is_valid = false;
+		reset_thumbnail_state((size_t) watch_idx);
+		if (!claim_watch_filename((size_t) watch_idx)) {
+			retire_watch_slot((size_t) watch_idx);
+			return;
+		}
+		if (fd != -1) {
+			arm_watch(fd, (size_t) watch_idx);
+		}
+	} else if (strcmp(new_config.action, watch_config[watch_idx].action) == 0 &&
+		   strcmp(new_config.db_title, watch_config[watch_idx].db_title) == 0 &&
+		   strcmp(new_config.db_author, watch_config[watch_idx].db_author) == 0 &&
+		   strcmp(new_config.db_comment, watch_config[watch_idx].db_comment) == 0 &&
+		   new_config.skip_db_checks == watch_config[watch_idx].skip_db_checks &&
+		   new_config.do_db_update == watch_config[watch_idx].do_db_update &&
+		   new_config.block_spawns == watch_config[watch_idx].block_spawns &&
+		   new_config.debounce_ms == watch_config[watch_idx].debounce_ms &&
+		   memcmp(&new_config.spawn_attrs, &watch_config[watch_idx].spawn_attrs, sizeof(SpawnAttrs)) == 0) {
+		LOG(LOG_INFO, "Watch config @ index %zd from '%s' is unchanged", watch_idx, name);
+		return;
+	} else {
+		// Same target, so its inotify watch can stay as-is
+		update_watch_config((size_t) watch_idx, &new_config);
+		LOG(LOG_INFO, "Watch config @ index %zd reloaded from '%s'", watch_idx, name);
+	}
+
+	LOG(LOG_INFO,
+	    "Watch config @ index %zd: filename=%s, action=%s, block_spawns=%d, debounce_ms=%hu, do_db_update=%d, db_title=%s, db_author=%s, db_comment=%s",
+	    watch_idx,
+	    watch_config[watch_idx].filename,
+	    watch_config[watch_idx].action,
+	    watch_config[watch_idx].block_spawns,
+	    watch_config[watch_idx].debounce_ms,
+	    watch_config[watch_idx].do_db_update,
+	    watch_config[watch_idx].db_title,
+	    watch_config[watch_idx].db_author,
+	    watch_config[watch_idx].db_comment);
+}
+
+// Take stock of our config directory again, reloading the config files that changed since we last looked,
+// and retiring the watches whose file is gone.
+// NOTE: As this goes through reload_config_file, only the watches that actually changed are re-armed.
+//       Files we've already reloaded on the fly (via our config directory watch) will simply be re-parsed once more.
+static void
+    reload_configs(int fd)
+{
+	config_reload_requested = false;
+
+	ConfigSnapshotFile* files      = NULL;
+	size_t              file_count = 0U;
+	if (scan_config_dir(&files, &file_count) != 0) {
+		LOG(LOG_WARNING, "Cannot scan config directory '%s', keeping our current configs", KFMON_CONFIGPATH);
+		return;
+	}
+	LOG(LOG_INFO, "Reloading our configs from '%s' . . .", KFMON_CONFIGPATH);
+	for (size_t i = 0U; i < file_count; i++) {
+		const ConfigSnapshotFile* old = find_config_file(config_files, config_file_count, files[i].name);
+		if (old && old->size == files[i].size && old->mtime == files[i].mtime) {
+			continue;
+		}
+		reload_config_file(fd, files[i].name);
+	}
+
+	// Check for leftovers
+	for (size_t watch_idx = 0U; watch_idx < watch_count; watch_idx++) {
+		if (watch_config[watch_idx].is_retired) {
+			continue;
+		}
+		if (!find_config_file(files, file_count, watch_config[watch_idx].config_file)) {
+			retire_watch(fd, watch_idx);
+		}
+	}
+
+	free(config_files);
+	config_files      = files;
+	config_file_count = file_count;
+}
+
+// Implementation of Qt4's QtHash (c.f., qhash @
+// https://github.com/kovidgoyal/calibre/blob/master/src/calibre/devices/kobo/driver.py#L37)
+static unsigned int
+    qhash(const unsigned char* bytes, size_t length)
+{
+	unsigned int h = 0;
+
+	for (unsigned int i = 0; i < length; i++) {
+		h = (h << 4) + bytes[i];
+		h ^= (h & 0xf0000000) >> 23;
+		h &= 0x0fffffff;
+	}
+
+	return h;
+}
+
+// Open Nickel's DB, and prepare the handful of statements we'll be needing for the lifetime of the connection.
+// NOTE: We keep this connection around across events, because on large Libraries,
+//       the open/parse schema/close dance is what took the most time by far in is_target_processed().
+//       It's torn down whenever our watches are (i.e., on unmount), or when the mount table changes,
+//       so we never keep a file open on a partition that's on its way out (f.g., for an USBMS session).
+static int
+    open_nickel_db(bool rw)
+{
+	int rc;
+
+	// NOTE: Open the db in multi-thread threading mode (we build w/ threadsafe and we don't use sqlite_config),
+	//       and without a shared cache because we have no use for it, we only do SQL from the main thread.
+	//       Unless we were asked to update it, open the DB ro to be extra-safe...
+	rc = sqlite3_open_v2(KOBO_DB_PATH,
+			     &nickel_db.db,
+			     (rw ? SQLITE_OPEN_READWRITE : SQLITE_OPEN_READONLY) | SQLITE_OPEN_NOMUTEX |
+				 SQLITE_OPEN_PRIVATECACHE,
+			     NULL);
+	if (rc != SQLITE_OK) {
+		LOG(LOG_CRIT, "open_v2 failed with status %d: %s", rc, sqlite3_errmsg(nickel_db.db));
+		close_nickel_db();
+		return -1;
+	}
+	nickel_db.is_rw = rw;
+
+	// Remember which file we actually opened, so we can tell if Nickel ever swaps it from under our feet...
+	struct stat st;
+	if (stat(KOBO_DB_PATH, &st) == 0) {
+		nickel_db.db_dev = st.st_dev;
+		nickel_db.db_ino = st.st_ino;
+	}
+
+	// NOTE: ContentType 6 should mean a book on pretty much anything since FW 1.9.17 (and why a book?
+	//       Because Nickel currently identifies single PNGs as application/x-cbz, bless its cute little bytes).
+	// NOTE: We only ever need a single lookup per check: the existence of the row, its ImageID and its Title
+	//       all come from the same B-tree lookup.
+	//       The UPDATE is made conditional on the Title, so we don't need a dedicated query to check it first.
+	//       Both run on their own (i.e., in autocommit mode): a single statement is already atomic,
+	//       and that way we never hold a lock on the DB while we're busy probing the thumbnails.
+	// NOTE: SQLITE_PREPARE_PERSISTENT would be nice, but it's only available since SQLite 3.20.0,
+	//       and we can't always be sure which version we're linked against in the sandbox.
+	const struct
+	{
+		sqlite3_stmt** stmt;
+		const char*    sql;
+	} stmts[] = {
+		{ &nickel_db.content_stmt,
+		  "SELECT ImageID, Title FROM content WHERE ContentID = @id AND ContentType = '6';" },
+		{ &nickel_db.update_stmt,
+		  "UPDATE content SET Title = @title, Attribution = @author, Description = @comment WHERE ContentID = @id AND ContentType = '6' AND Title IS NOT @title;" },
+	};
+	for (size_t i = 0; i < sizeof(stmts) / sizeof(*stmts); i++) {
+		rc = sqlite3_prepare_v2(nickel_db.db, stmts[i].sql, -1, stmts[i].stmt, NULL);
+		if (rc != SQLITE_OK) {
+			LOG(LOG_CRIT, "prepare_v2 failed with status %d: %s", rc, sqlite3_errmsg(nickel_db.db));
+			close_nickel_db();
+			return -1;
+		}
+	}
+
+	LOG(LOG_INFO, "Opened Nickel's DB (%s)", rw ? "rw" : "ro");
+	return 0;
+}
+
+// Finalize our statements, and close our connection to Nickel's DB (if it's open)
+static void
+    close_nickel_db(void)
+{
+	// NOTE: sqlite3_finalize & sqlite3_close are both harmless NOPs on a NULL pointer
+	sqlite3_finalize(nickel_db.content_stmt);
+	sqlite3_finalize(nickel_db.update_stmt);
+	if (nickel_db.db) {
+		if (sqlite3_close(nickel_db.db) != SQLITE_OK) {
+			LOG(LOG_WARNING, "Failed to close Nickel's DB: %s", sqlite3_errmsg(nickel_db.db));
+		} else {
+			LOG(LOG_INFO, "Closed Nickel's DB");
+		}
+	}
+	// NOTE: Only *after* the connection is gone, as closing it drops every POSIX lock we hold on the -shm,
+	//       including SQLite's (c.f., is_nickel_db_quiescent).
+	if (nickel_db.shm_fd != -1) {
+		close(nickel_db.shm_fd);
+	}
+
+	nickel_db = (NickelDB){ .shm_fd = -1 };
+}
+
+// Check whether the DB file we have open is still the one living at KOBO_DB_PATH
+// (f.g., Nickel may have replaced it wholesale after a factory reset or a sync).
+static bool
+    is_nickel_db_stale(void)
+{
+	struct stat st;
+	if (stat(KOBO_DB_PATH, &st) != 0) {
+		// It's gone, so whatever we're holding is stale...
+		return true;
+	}
+
+	return (st.st_dev != nickel_db.db_dev || st.st_ino != nickel_db.db_ino);
+}
+
+// Reset all our statements, and forget their bindings (so they don't keep pointing to stale storage).
+// NOTE: Resetting them also releases any lock they might still hold (f.g., if we bailed out in the middle of a step).
+static void
+    reset_nickel_db_stmts(void)
+{
+	sqlite3_stmt* stmts[] = { nickel_db.content_stmt, nickel_db.update_stmt };
+	for (size_t i = 0; i < sizeof(stmts) / sizeof(*stmts); i++) {
+		if (stmts[i]) {
+			sqlite3_reset(stmts[i]);
+			sqlite3_clear_bindings(stmts[i]);
+		}
+	}
+}
+
+// The suffix Nickel uses for each kind of thumbnail
+static const char*
+    get_thumbnail_kind_name(ThumbnailKind kind)
+{
+	switch (kind) {
+		case THUMBNAIL_N3_FULL:
+			return "N3_FULL";
+		case THUMBNAIL_N3_LIBRARY_FULL:
+			return "N3_LIBRARY_FULL";
+		case THUMBNAIL_N3_LIBRARY_GRID:
+			return "N3_LIBRARY_GRID";
+		default:
+			return "UNKNOWN";
+	}
+}
+
+// Build the path (relative to .kobo-images) of the directory Nickel stores a given ImageID's thumbnails in
+static void
+    get_thumbnail_subdir(const char* image_id, char* subdir, size_t len)
+{
+	// We need the proper hashes Nickel devises...
+	// c.f., images_path @
+	// https://github.com/kovidgoyal/calibre/blob/master/src/calibre/devices/kobo/driver.py#L2489
+	unsigned int hash = qhash((const unsigned char*) image_id, strlen(image_id));
+	unsigned int dir1 = hash & (0xff * 1);
+	unsigned int dir2 = (hash & (0xff00 * 1)) >> 8;
+
+	snprintf(subdir, len, "%u/%u", dir1, dir2);
+}
+
+// Build the filename of one of the thumbnails Nickel generates for a given ImageID
+static void
+    get_thumbnail_name(const char* image_id, ThumbnailKind kind, char* name, size_t len)
+{
+	snprintf(name, len, "%s - %s.parsed", image_id, get_thumbnail_kind_name(kind));
+}
+
+// Build the full path to one of the thumbnails Nickel generates for a given ImageID
+static void
+    get_thumbnail_path(const char* image_id, ThumbnailKind kind, char* thumbnail_path, size_t len)
+{
+	char subdir[16];
+	get_thumbnail_subdir(image_id, subdir, sizeof(subdir));
+	char name[KFMON_PATH_MAX];
+	get_thumbnail_name(image_id, kind, name, sizeof(name));
+
+	snprintf(thumbnail_path, len, "%s/.kobo-images/%s/%s", KFMON_TARGET_MOUNTPOINT, subdir, name);
+}
+
+// Make sure we have an fd on the directory holding the thumbnails of a watch's ImageID, and return it.
+// NOTE: This resets the watch's thumbnail state if its ImageID changed.
+static int
+    open_thumbnail_dir(size_t watch_idx, const char* image_id)
+{
+	ThumbnailState* state = &watch_config[watch_idx].thumbnails;
+	if (strcmp(state->image_id, image_id) != 0) {
+		reset_thumbnail_state(watch_idx);
+		snprintf(state->image_id, sizeof(state->image_id), "%s", image_id);
+	}
+	if (state->dfd != -1) {
+		return state->dfd;
+	}
+
+	// NOTE: We'd happily use O_PATH here, but it's not supported on the oldest kernels we may run on.
+	if (kobo_images_dfd == -1) {
+		kobo_images_dfd = open(KFMON_TARGET_MOUNTPOINT "/.kobo-images", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (kobo_images_dfd == -1) {
+			if (errno != ENOENT) {
+				perror("[KFMon] [WARN] open .kobo-images");
+			}
+			return -1;
+		}
+	}
+	char subdir[16];
+	get_thumbnail_subdir(image_id, subdir, sizeof(subdir));
+	state->dfd = openat(kobo_images_dfd, subdir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (state->dfd == -1 && errno != ENOENT) {
+		perror("[KFMon] [WARN] openat");
+	}
+	return state->dfd;
+}
+
+// Check which of the thumbnails of an ImageID exist in its directory
+static uint8_t
+    stat_thumbnails(int dfd, const char* image_id)
+{
+	uint8_t found = 0U;
+	for (ThumbnailKind kind = THUMBNAIL_N3_FULL; kind < THUMBNAIL_KIND_COUNT; kind++) {
+		char        name[KFMON_PATH_MAX];
+		struct stat st;
+		get_thumbnail_name(image_id, kind, name, sizeof(name));
+		if (fstatat(dfd, name, &st, 0) == 0) {
+			found |= (uint8_t)(1U << kind);
+		}
+	}
+	return found;
+}
+
+// Check whether Nickel has generated all the thumbnails of a watch's ImageID yet.
+// If it hasn't, keep an inotify watch on their directory, so we'll know as soon as it has,
+// and we won't have to check again in the meantime.
+static bool
+    probe_thumbnails(size_t watch_idx, const char* image_id)
+{
+	ThumbnailState* state = &watch_config[watch_idx].thumbnails;
+	int             dfd   = open_thumbnail_dir(watch_idx, image_id);
+
+	// NOTE: If the directory doesn't even exist yet, we can't watch it, so we'll simply check again next time.
+	if (dfd == -1) {
+		state->found = 0U;
+	} else if (state->wd == -1) {
+		// More often than not, Nickel is long done, so look first, and only bother with a watch if we have to.
+		state->found = stat_thumbnails(dfd, image_id);
+		if (state->found != THUMBNAILS_ALL && inotify_fd != -1) {
+			char dir_path[KFMON_PATH_MAX];
+			char subdir[16];
+			get_thumbnail_subdir(image_id, subdir, sizeof(subdir));
+			snprintf(dir_path, sizeof(dir_path), "%s/.kobo-images/%s", KFMON_TARGET_MOUNTPOINT, subdir);
+			int wd = inotify_add_watch(
+			    inotify_fd, dir_path, IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_ONLYDIR);
+			if (wd == -1) {
+				perror("[KFMon] [WARN] inotify_add_watch");
+			} else {
+				set_thumbnail_wd(watch_idx, wd);
+				// And look again, as something may have slipped through the cracks in between.
+				state->found = stat_thumbnails(dfd, image_id);
+			}
+		}
+	}
+	// NOTE: Otherwise, our inotify watch has been keeping track of things for us.
+
+	if (!(state->found & (1U << THUMBNAIL_N3_FULL))) {
+		LOG(LOG_INFO, "Full-size screensaver hasn't been parsed yet!");
+	}
+	// NOTE: This one might be a tad confusing...
+	//       If the icon has never been processed,
+	//       this will only happen the first time we *close* the PNG's "book"...
+	//       (i.e., the moment it pops up as the 'last opened' tile).
+	//       And *that* processing triggers a set of OPEN & CLOSE,
+	//       meaning we can quite possibly run on book *exit* that first time,
+	//       (and only that first time), if database locking permits...
+	if (!(state->found & (1U << THUMBNAIL_N3_LIBRARY_FULL))) {
+		LOG(LOG_INFO, "Homescreen tile hasn't been parsed yet!");
+	}
+	if (!(state->found & (1U << THUMBNAIL_N3_LIBRARY_GRID))) {
+		LOG(LOG_INFO, "Library thumbnail hasn't been parsed yet!");
+	}
+
+	// Only give a greenlight if we got all three!
+	if (state->found == THUMBNAILS_ALL) {
+		release_thumbnail_watch(watch_idx);
+		return true;
+	}
+	return false;
+}
+
+// Update the inotify watch descriptor on a watch's thumbnail directory, keeping our lookup table in sync
+static void
+    set_thumbnail_wd(size_t watch_idx, int wd)
+{
+	ThumbnailState* state = &watch_config[watch_idx].thumbnails;
+	if (state->wd != -1) {
+		wlt_remove(&thumbnail_wd_table, (size_t) state->wd, watch_idx);
+	}
+
+	state->wd = wd;
+
+	if (wd != -1) {
+		if (wlt_insert(&thumbnail_wd_table, (size_t) wd, watch_idx) != 0) {
+			LOG(LOG_ERR, "Failed to register wd %d in our lookup table, aborting!", wd);
+			notify("[KFMon] OOM ?!");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+// Drop a watch's inotify watch on its thumbnail directory
+static void
+    release_thumbnail_watch(size_t watch_idx)
+{
+	int wd = watch_config[watch_idx].thumbnails.wd;
+	if (wd == -1) {
+		return;
+	}
+	set_thumbnail_wd(watch_idx, -1);
+
+	// NOTE: Watching the same directory twice yields the same wd, so make sure nobody else still needs it...
+	size_t cursor = 0U;
+	if (wlt_find_next(&thumbnail_wd_table, (size_t) wd, &cursor) != -1) {
+		return;
+	}
+	// NOTE: This queues an IN_IGNORED event for a wd we've already forgotten about, which handle_events skips.
+	if (inotify_fd != -1 && inotify_rm_watch(inotify_fd, wd) == -1) {
+		perror("[KFMon] [WARN] inotify_rm_watch");
+	}
+}
+
+// Forget everything we know about a watch's thumbnails
+static void
+    reset_thumbnail_state(size_t watch_idx)
+{
+	ThumbnailState* state = &watch_config[watch_idx].thumbnails;
+
+	release_thumbnail_watch(watch_idx);
+	if (state->dfd != -1) {
+		close(state->dfd);
+	}
+	memset(state, 0, sizeof(*state));
+	state->dfd = -1;
+	state->wd  = -1;
+}
+
+// Let go of our thumbnail directories, so we don't keep the fs they live on busy (c.f., close_nickel_db)
+static void
+    close_thumbnail_dirs(void)
+{
+	for (size_t watch_idx = 0U; watch_idx < watch_count; watch_idx++) {
+		if (watch_config[watch_idx].thumbnails.dfd != -1) {
+			close(watch_config[watch_idx].thumbnails.dfd);
+			watch_config[watch_idx].thumbnails.dfd = -1;
+		}
+	}
+	if (kobo_images_dfd != -1) {
+		close(kobo_images_dfd);
+		kobo_images_dfd = -1;
+	}
+}
+
+// Keep track of thumbnails appearing in (or disappearing from) the directories we're keeping an eye on.
+// Returns false if the event wasn't for one of those.
+static bool
+    handle_thumbnail_event(const struct inotify_event* event)
+{
+	if (event->wd < 0) {
+		return false;
+	}
+
+	bool    is_handled = false;
+	size_t  cursor     = 0U;
+	ssize_t found_idx;
+	while ((found_idx = wlt_find_next(&thumbnail_wd_table, (size_t) event->wd, &cursor)) != -1) {
+		size_t          watch_idx = (size_t) found_idx;
+		ThumbnailState* state     = &watch_config[watch_idx].thumbnails;
+		is_handled                = true;
+
+		if (event->mask & IN_IGNORED) {
+			set_thumbnail_wd(watch_idx, -1);
+			continue;
+		}
+		if (!event->len) {
+			continue;
+		}
+		for (ThumbnailKind kind = THUMBNAIL_N3_FULL; kind < THUMBNAIL_KIND_COUNT; kind++) {
+			char name[KFMON_PATH_MAX];
+			get_thumbnail_name(state->image_id, kind, name, sizeof(name));
+			if (strcmp(event->name, name) != 0) {
+				continue;
+			}
+			if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+				state->found |= (uint8_t)(1U << kind);
+			} else {
+				state->found &= (uint8_t) ~(1U << kind);
+			}
+		}
+		if (state->found == THUMBNAILS_ALL) {
+			LOG(LOG_NOTICE,
+			    "Nickel has finished generating the thumbnails for '%s', it's ready to launch",
+			    watch_config[watch_idx].filename);
+			state->is_ready = true;
+			release_thumbnail_watch(watch_idx);
+		}
+	}
+
+	return is_handled;
+}
+
+// Check if our target file has been processed by Nickel, according to its DB (and the thumbnails it references)...
+// NOTE: image_id needs to be able to hold KFMON_PATH_MAX bytes, and is only filled if the target was processed.
+static bool
+    is_target_processed_in_db(size_t watch_idx, bool wait_for_db, char* image_id)
+{
+	sqlite3_stmt* stmt;
+	int           rc;
+	int           idx;
+	bool          is_processed = false;
+	bool          needs_update = false;
+
+	// Did the user want to try to update the DB for this icon?
+	bool update = watch_config[watch_idx].do_db_update;
+
+	// (Re)open the DB if we don't have a usable connection to it yet...
+	if (nickel_db.db && ((update && !nickel_db.is_rw) || is_nickel_db_stale())) {
+		LOG(LOG_INFO, "Our current connection to Nickel's DB is no longer suitable, reopening it");
+		close_nickel_db();
+	}
+	if (!nickel_db.db) {
+		if (open_nickel_db(update) != 0) {
+			return is_processed;
+		}
+	}
+	sqlite3* db = nickel_db.db;
+
+	// Wait at most for Nms on OPEN & N*2ms on CLOSE if we ever hit a locked database during any of our proceedings.
+	// NOTE: The defaults timings (steps of 500ms) appear to work reasonably well on my H2O with a 50MB Nickel DB...
+	//       (i.e., it trips on OPEN when Nickel is moderately busy, but if everything's quiet, we're good).
+	//       Time will tell if that's a good middle-ground or not ;).
+	//       This is user configurable in kfmon.ini (db_timeout key).
+	// NOTE: On current FW versions, where the DB is now using WAL, we're exceedingly unlikely to ever hit a BUSY DB
+	//       (c.f., https://www.sqlite.org/wal.html)
+	sqlite3_busy_timeout(db, (int) daemon_config.db_timeout * (wait_for_db + 1));
+	DBGLOG("SQLite busy timeout set to %dms", (int) daemon_config.db_timeout * (wait_for_db + 1));
+
+	// Append the proper URI scheme to our icon path...
+	char book_path[KFMON_PATH_MAX + 7];
+	snprintf(book_path, KFMON_PATH_MAX + 7, "file://%s", watch_config[watch_idx].filename);
+
+	// Keep track of how many actual queries we run for this check
+	uint8_t queries = 0U;
+
+	// One single lookup tells us everything we need to know:
+	// if the book exists, where to look for its thumbnails, and whether it needs to be updated...
+	stmt = nickel_db.content_stmt;
+	idx  = sqlite3_bind_parameter_index(stmt, "@id");
+	CALL_SQLITE(bind_text(stmt, idx, book_path, -1, SQLITE_STATIC));
+
+	bool is_in_db = false;
+	rc            = sqlite3_step(stmt);
+	queries++;
+	if (rc == SQLITE_ROW) {
+		is_in_db     = true;
+		is_processed = true;
+
+		// Make a copy of the ImageID, so we can reset the statement (and release its read lock) right away.
+		// NOTE: This also means we can't accidentally hold a pointer to a result depending on the statement.
+		size_t len = MIN((size_t) sqlite3_column_bytes(stmt, 0), (size_t) KFMON_PATH_MAX - 1U);
+		memcpy(image_id, sqlite3_column_text(stmt, 0), len);
+		image_id[len] = '\0';
+		DBGLOG("SELECT SQL query returned: %s | %s", image_id, sqlite3_column_text(stmt, 1));
+	}
+
+	// NOTE: This is what actually releases our read lock, so do it before we go poking at the filesystem.
+	sqlite3_reset(stmt);
+
+	// Now that we know the book exists, we also want to check if the thumbnails do,
+	// to avoid getting triggered from the thumbnail creation...
+	// NOTE: Again, this assumes FW >= 2.9.0
+	if (is_processed) {
+		struct timespec probe_ts;
+		get_monotonic_time(&probe_ts);
+
+		is_processed = probe_thumbnails(watch_idx, image_id);
+
+		record_latency(watch_idx, LAT_THUMBNAIL_PROBE, &probe_ts);
+	}
+
+	// NOTE: Here be dragons!
+	//       This works in theory,
+	//       but risks confusing Nickel's handling of the DB if we do that when nickel is running (which we are).
+	//       Because doing it with Nickel running is a potentially terrible idea,
+	//       for various reasons (c.f., https://www.sqlite.org/howtocorrupt.html for the gory details,
+	//       some of which probably even apply here! :p).
+	//       As such, we leave enabling this option to the user's responsibility.
+	//       KOReader ships with it disabled.
+	//       The idea is to, optionally, update the Title, Author & Comment fields to make them more useful...
+	// NOTE: The UPDATE itself only matches if the Title isn't already the one we want,
+	//       so it's a no-op if the DB has already been updated.
+	//       It runs on its own, in autocommit mode, so that's the only time we ever need the write lock.
+	if (is_processed && update) {
+		stmt = nickel_db.update_stmt;
+
+		// NOTE: No sanity checks are done to confirm that those watch configs are sane,
 		//       we only check that they are *present*...
 		//       The example config ships with a strong warning not to forget them if wanted, but that's it.
 		idx = sqlite3_bind_parameter_index(stmt, "@title");
@@ -899,429 +3015,2586 @@ static bool
 		idx = sqlite3_bind_parameter_index(stmt, "@id");
 		CALL_SQLITE(bind_text(stmt, idx, book_path, -1, SQLITE_STATIC));
 
-		rc = sqlite3_step(stmt);
-		if (rc != SQLITE_DONE) {
-			LOG(LOG_WARNING, "UPDATE SQL query failed: %s", sqlite3_errmsg(db));
+		rc = sqlite3_step(stmt);
+		queries++;
+		if (rc != SQLITE_DONE) {
+			LOG(LOG_WARNING, "UPDATE SQL query failed: %s", sqlite3_errmsg(db));
+		} else if (sqlite3_changes(db) > 0) {
+			needs_update = true;
+			LOG(LOG_NOTICE, "Successfully updated DB data for the target PNG");
+		} else {
+			DBGLOG("DB data for the target PNG is already up to date");
+		}
+
+		sqlite3_reset(stmt);
+	}
+
+	// Forget about our bindings, since they point to our stack...
+	reset_nickel_db_stmts();
+
+	// Recap how many queries that took, vs. how many the original design would have needed
+	// (EXISTS, then ImageID if it exists, then Title if processed & update, then UPDATE if the Title didn't match).
+	uint8_t legacy_queries = (uint8_t)(1U + is_in_db + (is_processed && update) + needs_update);
+	db_stats.queries += queries;
+	db_stats.legacy_queries += legacy_queries;
+	LOG(LOG_INFO,
+	    "DB check for watch idx %zu took %hhu queries (vs. %hhu before query consolidation); %lu vs. %lu overall",
+	    watch_idx,
+	    queries,
+	    legacy_queries,
+	    db_stats.queries,
+	    db_stats.legacy_queries);
+
+	return is_processed;
+}
+
+// Load our cache of fingerprints for target icons we've already confirmed as fully processed by Nickel
+static void
+    load_processed_cache(void)
+{
+	FILE* f = fopen(KFMON_PROCESSED_CACHE, "re");
+	if (!f) {
+		if (errno != ENOENT) {
+			perror("[KFMon] [WARN] fopen");
+		}
+		LOG(LOG_INFO, "No processed cache to load");
+		return;
+	}
+
+	ProcessedCacheHeader header;
+	if (fread(&header, sizeof(header), 1U, f) != 1U ||
+	    memcmp(header.magic, KFMON_PROCESSED_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+	    header.version != KFMON_PROCESSED_CACHE_VERSION) {
+		LOG(LOG_WARNING, "Processed cache '%s' is invalid or outdated, ignoring it", KFMON_PROCESSED_CACHE);
+		fclose(f);
+		return;
+	}
+
+	size_t               hits = 0U;
+	ProcessedCacheRecord record;
+	for (uint32_t i = 0U; i < header.count; i++) {
+		if (fread(&record, sizeof(record), 1U, f) != 1U) {
+			LOG(LOG_WARNING, "Processed cache '%s' is truncated", KFMON_PROCESSED_CACHE);
+			break;
+		}
+		// Make sure we won't run off into the weeds...
+		record.filename[KFMON_PATH_MAX - 1]             = '\0';
+		record.fingerprint.image_id[KFMON_PATH_MAX - 1] = '\0';
+
+		// Match it to its watch, if we still have one...
+		ssize_t watch_idx = find_watch_by_filename(record.filename);
+		if (watch_idx != -1) {
+			watch_config[watch_idx].fingerprint          = record.fingerprint;
+			watch_config[watch_idx].fingerprint.is_valid = true;
+			hits++;
+		}
+	}
+	fclose(f);
+
+	LOG(LOG_INFO, "Loaded %zu processed cache entries from '%s'", hits, KFMON_PROCESSED_CACHE);
+}
+
+// Flush our processed cache to disk, atomically
+// NOTE: We only ever do this when something actually changed, which should be exceedingly rare.
+static void
+    save_processed_cache(void)
+{
+	char tmp_path[] = KFMON_PROCESSED_CACHE ".tmp";
+	int  fd         = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd == -1) {
+		perror("[KFMon] [WARN] open");
+		return;
+	}
+	FILE* f = fdopen(fd, "w");
+	if (!f) {
+		perror("[KFMon] [WARN] fdopen");
+		close(fd);
+		unlink(tmp_path);
+		return;
+	}
+
+	ProcessedCacheHeader header = { 0 };
+	memcpy(header.magic, KFMON_PROCESSED_CACHE_MAGIC, sizeof(header.magic));
+	header.version = KFMON_PROCESSED_CACHE_VERSION;
+	for (size_t watch_idx = 0; watch_idx < watch_count; watch_idx++) {
+		if (watch_config[watch_idx].fingerprint.is_valid) {
+			header.count++;
+		}
+	}
+
+	bool ok = (fwrite(&header, sizeof(header), 1U, f) == 1U);
+	for (size_t watch_idx = 0; ok && watch_idx < watch_count; watch_idx++) {
+		if (!watch_config[watch_idx].fingerprint.is_valid) {
+			continue;
+		}
+		// NOTE: Zero-init to avoid writing uninitialized padding bytes to disk
+		ProcessedCacheRecord record = { 0 };
+		// NOTE: Both buffers are the same size, and the source is zero-padded (c.f., watch_handler)
+		memcpy(record.filename, watch_config[watch_idx].filename, sizeof(record.filename));
+		record.fingerprint = watch_config[watch_idx].fingerprint;
+		ok                 = (fwrite(&record, sizeof(record), 1U, f) == 1U);
+	}
+	if (fflush(f) != 0 || fsync(fd) != 0) {
+		ok = false;
+	}
+	fclose(f);
+
+	if (!ok || rename(tmp_path, KFMON_PROCESSED_CACHE) != 0) {
+		LOG(LOG_WARNING, "Failed to write processed cache to '%s'", KFMON_PROCESSED_CACHE);
+		unlink(tmp_path);
+	}
+}
+
+// Compute the fingerprint of a target icon (without touching its ImageID)
+static bool
+    get_target_fingerprint(size_t watch_idx, ProcessedFingerprint* fingerprint)
+{
+	struct stat st;
+	if (stat(watch_config[watch_idx].filename, &st) != 0) {
+		return false;
+	}
+
+	// NOTE: vfat synthesizes inode numbers dynamically, so they're not stable across remounts (let alone reboots).
+	//       Since that's precisely what onboard is, only take inodes into account on filesystems that can afford it.
+	struct statfs sfs;
+	if (statfs(watch_config[watch_idx].filename, &sfs) == 0 && sfs.f_type == MSDOS_SUPER_MAGIC) {
+		fingerprint->ino = 0U;
+	} else {
+		fingerprint->ino = (uint64_t) st.st_ino;
+	}
+	fingerprint->size       = (int64_t) st.st_size;
+	fingerprint->mtime      = (int64_t) st.st_mtime;
+	fingerprint->title_hash = watch_config[watch_idx].do_db_update
+				      ? qhash((const unsigned char*) watch_config[watch_idx].db_title,
+					      strlen(watch_config[watch_idx].db_title))
+				      : 0U;
+
+	return true;
+}
+
+// Check if we already know for sure that a target icon has been fully processed,
+// without having to bother Nickel's DB. Invalidates the cached fingerprint if it's outdated.
+static bool
+    is_target_processed_cached(size_t watch_idx)
+{
+	ProcessedFingerprint* cached = &watch_config[watch_idx].fingerprint;
+	if (!cached->is_valid) {
+		return false;
+	}
+
+	ProcessedFingerprint current = { 0 };
+	bool                 is_hit  = get_target_fingerprint(watch_idx, &current);
+	if (is_hit) {
+		is_hit = (current.ino == cached->ino && current.size == cached->size &&
+			  current.mtime == cached->mtime && current.title_hash == cached->title_hash);
+		if (!is_hit) {
+			LOG(LOG_INFO,
+			    "Target icon '%s' has changed since it was processed",
+			    watch_config[watch_idx].filename);
+		}
+	}
+
+	// Make sure the thumbnails are still there, too...
+	if (is_hit) {
+		struct timespec probe_ts;
+		get_monotonic_time(&probe_ts);
+
+		int dfd = open_thumbnail_dir(watch_idx, cached->image_id);
+		is_hit  = (dfd != -1);
+		for (ThumbnailKind kind = THUMBNAIL_N3_FULL; is_hit && kind < THUMBNAIL_KIND_COUNT; kind++) {
+			char        name[KFMON_PATH_MAX];
+			struct stat st;
+			get_thumbnail_name(cached->image_id, kind, name, sizeof(name));
+			if (fstatat(dfd, name, &st, 0) != 0) {
+				char thumbnail_path[KFMON_PATH_MAX];
+				get_thumbnail_path(cached->image_id, kind, thumbnail_path, sizeof(thumbnail_path));
+				LOG(LOG_INFO, "Thumbnail '%s' has disappeared", thumbnail_path);
+				is_hit = false;
+			}
+		}
+
+		record_latency(watch_idx, LAT_THUMBNAIL_PROBE, &probe_ts);
+	}
+
+	if (!is_hit) {
+		LOG(LOG_INFO, "Invalidating processed cache entry for '%s'", watch_config[watch_idx].filename);
+		*cached = (ProcessedFingerprint){ 0 };
+		reset_thumbnail_state(watch_idx);
+		save_processed_cache();
+	}
+
+	return is_hit;
+}
+
+// Remember that a target icon has been fully processed by Nickel
+static void
+    remember_processed_target(size_t watch_idx, const char* image_id)
+{
+	ProcessedFingerprint fingerprint = { 0 };
+	if (!get_target_fingerprint(watch_idx, &fingerprint)) {
+		return;
+	}
+	snprintf(fingerprint.image_id, sizeof(fingerprint.image_id), "%s", image_id);
+	fingerprint.is_valid = true;
+
+	watch_config[watch_idx].fingerprint = fingerprint;
+	save_processed_cache();
+	DBGLOG("Cached processed fingerprint for '%s'", watch_config[watch_idx].filename);
+}
+
+// Check if our target file has been processed by Nickel...
+static bool
+    is_target_processed(size_t watch_idx, bool wait_for_db)
+{
+	bool            is_processed = false;
+	struct timespec check_ts;
+	get_monotonic_time(&check_ts);
+
+#ifdef DEBUG
+	// Bypass DB checks on demand for debugging purposes...
+	if (watch_config[watch_idx].skip_db_checks)
+		return true;
+#endif
+
+	// Once Nickel is done with an icon, it pretty much never goes back on it, so,
+	// if we've already seen it fully processed, and it hasn't changed since, we can skip SQLite entirely.
+	if (is_target_processed_cached(watch_idx)) {
+		LOG(LOG_INFO,
+		    "Target icon '%s' is already known to be processed, skipping DB checks",
+		    watch_config[watch_idx].filename);
+		is_processed = true;
+	} else if (watch_config[watch_idx].thumbnails.is_ready && !watch_config[watch_idx].do_db_update) {
+		// We were still waiting on Nickel last time, but our inotify watch saw it finish in the meantime,
+		// and we already know the book is in the DB, so there's nothing left to check.
+		// NOTE: Unless we have an UPDATE to run, which warrants going through the DB anyway.
+		LOG(LOG_INFO,
+		    "Target icon '%s' has been processed since our last check, skipping DB checks",
+		    watch_config[watch_idx].filename);
+		watch_config[watch_idx].thumbnails.is_ready = false;
+		is_processed                                = true;
+		remember_processed_target(watch_idx, watch_config[watch_idx].thumbnails.image_id);
+	} else if (watch_config[watch_idx].thumbnails.wd != -1) {
+		// Conversely, as long as our inotify watch is up, we know Nickel hasn't finished yet.
+		LOG(LOG_INFO,
+		    "Still waiting for Nickel to generate the thumbnails for '%s', skipping DB checks",
+		    watch_config[watch_idx].filename);
+	} else {
+		char image_id[KFMON_PATH_MAX];
+		is_processed = is_target_processed_in_db(watch_idx, wait_for_db, image_id);
+		if (is_processed) {
+			remember_processed_target(watch_idx, image_id);
+		}
+	}
+
+	record_latency(watch_idx, LAT_PROCESSED_CHECK, &check_ts);
+	return is_processed;
+}
+
+// Check that Nickel isn't in the middle of writing to its DB
+// NOTE: We used to just sleep in 500ms steps as long as a rollback journal was there,
+//       but that assumed the default journal_mode (DELETE). That's no longer the case on FW >= 4.6.x
+//       (and possibly earlier), where the DB is using WAL, in which case we check the wal-index locks instead.
+static bool
+    is_nickel_db_quiescent(void)
+{
+	// Rollback journal: as long as it's there, a transaction is in flight
+	if (access(KOBO_DB_PATH "-journal", F_OK) == 0) {
+		DBGLOG("Found a SQLite rollback journal");
+		return false;
+	}
+
+	// WAL: a writer holds WAL_WRITE_LOCK until it commits, and a checkpointer holds WAL_CKPT_LOCK until it's done.
+	// Those are plain POSIX advisory locks on the -shm file, so we can check them without taking part in them.
+	// NOTE: F_GETLK only ever reports *other* processes' locks, so our own connection doesn't get in the way.
+	//       On the other hand, closing *any* fd on a file drops *all* of our POSIX locks on it,
+	//       including the ones our SQLite connection holds on the -shm, so we keep ours open alongside the connection,
+	//       and only ever close it once the connection is gone (c.f., close_nickel_db).
+	struct stat st;
+	if (stat(KOBO_DB_PATH "-shm", &st) == -1) {
+		// No WAL (or no wal-index to speak of), nothing more to check
+		return true;
+	}
+	if (nickel_db.shm_fd != -1 && (st.st_dev != nickel_db.shm_dev || st.st_ino != nickel_db.shm_ino)) {
+		// It was replaced from under our feet, so our fd (and our connection, if any) is on a stale file.
+		if (nickel_db.db) {
+			LOG(LOG_INFO, "Nickel's wal-index was replaced, reopening our connection to its DB");
+			close_nickel_db();
+		} else {
+			close(nickel_db.shm_fd);
+			nickel_db.shm_fd = -1;
+		}
+	}
+	if (nickel_db.shm_fd == -1) {
+		nickel_db.shm_fd = open(KOBO_DB_PATH "-shm", O_RDONLY | O_CLOEXEC);
+		if (nickel_db.shm_fd == -1) {
+			return true;
+		}
+		// NOTE: If this fails, it'll just look stale next time.
+		if (fstat(nickel_db.shm_fd, &st) == -1) {
+			perror("[KFMon] [WARN] fstat");
+			st.st_dev = 0;
+			st.st_ino = 0;
+		}
+		nickel_db.shm_dev = st.st_dev;
+		nickel_db.shm_ino = st.st_ino;
+	}
+	struct flock fl = { 0 };
+	fl.l_type       = F_WRLCK;
+	fl.l_whence     = SEEK_SET;
+	fl.l_start      = WAL_SHM_LOCK_OFFSET;
+	fl.l_len        = WAL_SHM_LOCK_COUNT;
+	int ret         = fcntl(nickel_db.shm_fd, F_GETLK, &fl);
+	if (ret == -1) {
+		perror("[KFMon] [WARN] fcntl F_GETLK");
+		return true;
+	}
+	if (fl.l_type != F_UNLCK) {
+		DBGLOG("Nickel (pid %ld) is writing to or checkpointing its DB", (long) fl.l_pid);
+		return false;
+	}
+
+	return true;
+}
+
+// Put a watch's launch on hold until Nickel's DB is quiescent
+// NOTE: Instead of blocking the event loop, we keep an eye on the DB's directory (for the rollback journal going away),
+//       and re-check on a short tick (for the WAL locks, since those don't trip any inotify event),
+//       with a deadline after which we give up waiting and launch anyway.
+// NOTE: This is only ever called right after the watch made it to WATCH_READY, which is what marks it as on hold.
+static void
+    defer_launch(size_t watch_idx)
+{
+	LOG(LOG_INFO,
+	    "Nickel's DB is busy, holding off the launch of %s for watch idx %zu until it's done",
+	    watch_config[watch_idx].action,
+	    watch_idx);
+	watch_config[watch_idx].deferred_event_ts = event_ts;
+
+	// First one in starts the clock
+	if (db_wait.count++ > 0U) {
+		return;
+	}
+	get_monotonic_time(&db_wait.started);
+	if (inotify_fd != -1) {
+		db_wait.wd = inotify_add_watch(inotify_fd, KOBO_DB_DIR, IN_DELETE | IN_MOVED_FROM | IN_CLOSE_WRITE);
+		if (db_wait.wd == -1) {
+			perror("[KFMon] [WARN] inotify_add_watch");
+		}
+	}
+	const struct itimerspec tick = { { 0L, DB_WAIT_TICK_MS * 1000000L }, { 0L, DB_WAIT_TICK_MS * 1000000L } };
+	if (timerfd_settime(db_wait.timer_fd, 0, &tick, NULL) == -1) {
+		perror("[KFMon] [WARN] timerfd_settime");
+	}
+}
+
+// We're done waiting on Nickel's DB
+static void
+    stop_db_wait(void)
+{
+	db_wait.count = 0U;
+	if (db_wait.wd != -1) {
+		// NOTE: This queues an IN_IGNORED event for a wd we've already forgotten about, which handle_events skips.
+		if (inotify_fd != -1 && inotify_rm_watch(inotify_fd, db_wait.wd) == -1) {
+			perror("[KFMon] [WARN] inotify_rm_watch");
+		}
+		db_wait.wd = -1;
+	}
+	const struct itimerspec disarm = { { 0L, 0L }, { 0L, 0L } };
+	if (timerfd_settime(db_wait.timer_fd, 0, &disarm, NULL) == -1) {
+		perror("[KFMon] [WARN] timerfd_settime");
+	}
+}
+
+// Something happened to Nickel's DB (or our tick expired), see if we can go ahead with our deferred launches
+static void
+    handle_db_wait(bool is_tick)
+{
+	if (is_tick) {
+		uint64_t expirations;
+		if (read(db_wait.timer_fd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN) {    // Flawfinder: ignore
+			perror("[KFMon] [WARN] read timerfd");
+		}
+	}
+	if (db_wait.count == 0U) {
+		return;
+	}
+
+	if (!is_nickel_db_quiescent()) {
+		if (get_elapsed_us(&db_wait.started) < DB_WAIT_TIMEOUT_MS * 1000U) {
+			return;
+		}
+		LOG(LOG_WARNING, "Waited for Nickel's DB to settle down for far too long, going on anyway.");
+	}
+
+	stop_db_wait();
+	for (size_t watch_idx = 0U; watch_idx < watch_count; watch_idx++) {
+		if (watch_config[watch_idx].state != WATCH_READY) {
+			continue;
+		}
+		record_latency(watch_idx, LAT_JOURNAL_WAIT, &watch_config[watch_idx].deferred_event_ts);
+
+		// Things may have changed while we were waiting...
+		JournalDecision decision = JOURNAL_NONE;
+		uint64_t        spawn_us = 0U;
+		pid_t           spid     = -1;
+		if (watch_config[watch_idx].is_retired) {
+			update_watch_state(watch_idx, WATCH_EV_CANCEL);
+			continue;
+		} else if (is_blocker_running()) {
+			update_watch_state(watch_idx, WATCH_EV_CANCEL);
+			decision = JOURNAL_BLOCKED;
+			LOG(LOG_INFO,
+			    "As a spawn blocker process is currently running, we won't be spawning anything else to prevent unwanted behavior!");
+		} else {
+			// NOTE: Keep our event -> launch latency honest
+			event_ts = watch_config[watch_idx].deferred_event_ts;
+			spid     = launch_watch(watch_idx, &spawn_us);
+			decision = spid == -1 ? JOURNAL_FAILED : JOURNAL_SPAWNED;
+		}
+		journal_event((ssize_t) watch_idx, 0U, decision, 0U, spawn_us, spid);
+	}
+}
+
+// Forget about the launches we had on hold (f.g., because our target mountpoint went away)
+static void
+    cancel_deferred_launches(void)
+{
+	if (db_wait.count == 0U) {
+		return;
+	}
+	for (size_t watch_idx = 0U; watch_idx < watch_count; watch_idx++) {
+		if (watch_config[watch_idx].state == WATCH_READY) {
+			LOG(LOG_NOTICE,
+			    "Cancelling the deferred launch of %s for watch idx %zu",
+			    watch_config[watch_idx].action,
+			    watch_idx);
+			update_watch_state(watch_idx, WATCH_EV_CANCEL);
+		}
+	}
+	stop_db_wait();
+}
+
+// Heavily inspired from https://stackoverflow.com/a/35235950
+// Initializes the process table. -1 means the entry in the table is available.
+// NOTE: Sized after our watch registry, since a watch can only ever have a single running spawn.
+static int
+    init_process_table(void)
+{
+	// Make sure we never end up with a zero-sized allocation
+	size_t size       = MAX(watch_count, (size_t) 1U);
+	PT.spawn_pids     = calloc(size, sizeof(*PT.spawn_pids));
+	PT.spawn_watchids = calloc(size, sizeof(*PT.spawn_watchids));
+	PT.spawn_pidfds   = calloc(size, sizeof(*PT.spawn_pidfds));
+	PT.free_entries   = calloc(size, sizeof(*PT.free_entries));
+	if (PT.spawn_pids == NULL || PT.spawn_watchids == NULL || PT.spawn_pidfds == NULL || PT.free_entries == NULL) {
+		perror("[KFMon] [CRIT] calloc");
+		return -1;
+	}
+	PT.size = size;
+
+	for (size_t i = 0; i < PT.size; i++) {
+		PT.spawn_pids[i]     = -1;
+		PT.spawn_watchids[i] = -1;
+		PT.spawn_pidfds[i]   = -1;
+		// Hand out the lowest entries first
+		PT.free_entries[i] = PT.size - 1U - i;
+	}
+	PT.free_count = PT.size;
+
+	return 0;
+}
+
+// Make room for at least size entries, so that we can still track one spawn per watch after a config reload
+static int
+    grow_process_table(size_t size)
+{
+	if (size <= PT.size) {
+		return 0;
+	}
+
+	// NOTE: If one of these fails, the ones that succeeded are merely larger than they need to be.
+	pid_t* spawn_pids = realloc(PT.spawn_pids, size * sizeof(*PT.spawn_pids));
+	if (spawn_pids == NULL) {
+		perror("[KFMon] [CRIT] realloc");
+		return -1;
+	}
+	PT.spawn_pids = spawn_pids;
+	ssize_t* spawn_watchids = realloc(PT.spawn_watchids, size * sizeof(*PT.spawn_watchids));
+	if (spawn_watchids == NULL) {
+		perror("[KFMon] [CRIT] realloc");
+		return -1;
+	}
+	PT.spawn_watchids = spawn_watchids;
+	int* spawn_pidfds = realloc(PT.spawn_pidfds, size * sizeof(*PT.spawn_pidfds));
+	if (spawn_pidfds == NULL) {
+		perror("[KFMon] [CRIT] realloc");
+		return -1;
+	}
+	PT.spawn_pidfds = spawn_pidfds;
+	size_t* free_entries = realloc(PT.free_entries, size * sizeof(*PT.free_entries));
+	if (free_entries == NULL) {
+		perror("[KFMon] [CRIT] realloc");
+		return -1;
+	}
+	PT.free_entries = free_entries;
+
+	// Push the new entries on our free stack, lowest on top
+	for (size_t i = size; i-- > PT.size;) {
+		PT.spawn_pids[i]                 = -1;
+		PT.spawn_watchids[i]             = -1;
+		PT.spawn_pidfds[i]               = -1;
+		PT.free_entries[PT.free_count++] = i;
+	}
+	PT.size = size;
+
+	return 0;
+}
+
+// Returns the index of the next available entry in the process table.
+static ssize_t
+    get_next_available_pt_entry(void)
+{
+	if (PT.free_count == 0U) {
+		return -1;
+	}
+
+	return (ssize_t) PT.free_entries[PT.free_count - 1U];
+}
+
+// Adds information about a new spawn to the process table.
+// NOTE: i *has* to be the entry we just got from get_next_available_pt_entry!
+static void
+    add_process_to_table(size_t i, pid_t pid, size_t watch_idx)
+{
+	PT.spawn_pids[i]     = pid;
+	PT.spawn_watchids[i] = (ssize_t) watch_idx;
+	PT.free_count--;
+
+	WatchConfig* watch = &watch_config[watch_idx];
+	watch->spawn_pid   = pid;
+	watch->spawn_count++;
+	// NOTE: Remember whether it was a blocker *when it was spawned*, its config may very well change in the meantime.
+	watch->is_spawn_blocker = watch->block_spawns;
+	if (watch->is_spawn_blocker) {
+		running_blockers++;
+	}
+	update_watch_state(watch_idx, WATCH_EV_EXEC_OK);
+}
+
+// Removes information about a spawn from the process table.
+static void
+    remove_process_from_table(size_t i)
+{
+	WatchConfig* watch = &watch_config[PT.spawn_watchids[i]];
+	watch->spawn_pid   = -1;
+	if (watch->is_spawn_blocker) {
+		watch->is_spawn_blocker = false;
+		running_blockers--;
+	}
+	update_watch_state((size_t) PT.spawn_watchids[i], WATCH_EV_REAPED);
+	// Its slot was only kept around for our sake (c.f., retire_watch_slot)
+	if (watch->is_retired) {
+		free_watch_slots[free_watch_count++] = (size_t) PT.spawn_watchids[i];
+	}
+
+	PT.spawn_pids[i]                 = -1;
+	PT.spawn_watchids[i]             = -1;
+	PT.free_entries[PT.free_count++] = i;
+}
+
+// Initializes the FBInk config
+static void
+    init_fbink_config(void)
+{
+	// NOTE: The struct is zero-initialized, so we only tweak what's non-default
+	//       (the defaults are explictly designed to always be 0 for this very purpose).
+	fbink_config.row         = -5;
+	fbink_config.is_centered = true;
+	fbink_config.is_padded   = true;
+	// NOTE: For now, we *want* fbink_init's status report logged, so we leave this disabled.
+	// fbink_config.is_quiet = false;
+}
+
+// Remember the fb setup FBInk was initialized with
+static void
+    init_fb_state(void)
+{
+	fb_state.fd = open(KFMON_FB_DEVICE, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fb_state.fd == -1) {
+		perror("[KFMon] [WARN] open");
+		LOG(LOG_WARNING, "Cannot keep an eye on the framebuffer, FBInk will be reinitialized on every event");
+		return;
+	}
+	probe_fb_state();
+}
+
+// Check whether the fb setup changed since we last looked (or if we can't tell)
+static bool
+    probe_fb_state(void)
+{
+	if (fb_state.fd == -1) {
+		return true;
+	}
+
+	struct fb_var_screeninfo vinfo;
+	if (ioctl(fb_state.fd, FBIOGET_VSCREENINFO, &vinfo) == -1) {
+		perror("[KFMon] [WARN] ioctl FBIOGET_VSCREENINFO");
+		return true;
+	}
+	if (vinfo.xres == fb_state.xres && vinfo.yres == fb_state.yres &&
+	    vinfo.bits_per_pixel == fb_state.bits_per_pixel && vinfo.rotate == fb_state.rotate) {
+		return false;
+	}
+
+	fb_state.xres           = vinfo.xres;
+	fb_state.yres           = vinfo.yres;
+	fb_state.bits_per_pixel = vinfo.bits_per_pixel;
+	fb_state.rotate         = vinfo.rotate;
+	return true;
+}
+
+// Make sure FBInk's view of the fb is up to date before we print anything
+// NOTE: This is needed because processing is done very early by Nickel for "new" icons when
+//       they end up on the Home screen straight away,
+//       (which is a given if you added at most 3 items, with the new Home screen).
+//       It's problematic for us, because it's early enough that pickel is still running,
+//       so we inherit its quirky fb setup and not Nickel's...
+//       That only costs us an ioctl, as we only actually reinit when the fb setup changed.
+static void
+    refresh_fbink(void)
+{
+	if (!probe_fb_state()) {
+		return;
+	}
+
+	// NOTE: If we can't probe it ourselves, that's the best we can do, as FBInk will check on its own anyway.
+	if (fb_state.fd != -1) {
+		LOG(LOG_INFO,
+		    "Framebuffer setup is now %ux%u @ %ubpp (rota %u), reinitializing FBInk",
+		    fb_state.xres,
+		    fb_state.yres,
+		    fb_state.bits_per_pixel,
+		    fb_state.rotate);
+	}
+	// NOTE: It went fine once, assume that'll still be the case and skip error checking...
+	fbink_reinit(FBFD_AUTO, &fbink_config);
+}
+
+// CLOCK_MONOTONIC, because we only ever care about intervals
+static void
+    get_monotonic_time(struct timespec* ts)
+{
+	clock_gettime(CLOCK_MONOTONIC, ts);
+}
+
+// How many us went by since start
+static uint64_t
+    get_elapsed_us(const struct timespec* start)
+{
+	struct timespec now;
+	get_monotonic_time(&now);
+
+	int64_t delta_us = ((int64_t) now.tv_sec - (int64_t) start->tv_sec) * 1000000 +
+			   ((int64_t) now.tv_nsec - (int64_t) start->tv_nsec) / 1000;
+	return delta_us > 0 ? (uint64_t) delta_us : 0U;
+}
+
+// Account for the time elapsed since start in the given stage's histogram for this watch
+static void
+    record_latency(size_t watch_idx, LatencyStage stage, const struct timespec* start)
+{
+	uint64_t us = get_elapsed_us(start);
+
+	// Bucket n holds samples < 2^n us
+	size_t bucket = 0U;
+	while (bucket < LAT_BUCKET_COUNT - 1U && us >= (1ULL << bucket)) {
+		bucket++;
+	}
+
+	LatencyHistogram* hist = &watch_config[watch_idx].latency[stage];
+	hist->buckets[bucket]++;
+	hist->count++;
+	hist->total_us += us;
+	hist->max_us = MAX(hist->max_us, us);
+}
+
+static const char*
+    get_latency_stage_name(LatencyStage stage)
+{
+	switch (stage) {
+		case LAT_PROCESSED_CHECK:
+			return "processed check";
+		case LAT_THUMBNAIL_PROBE:
+			return "thumbnail probe";
+		case LAT_JOURNAL_WAIT:
+			return "journal wait";
+		case LAT_SPAWN:
+			return "spawn";
+		case LAT_EVENT_TO_LAUNCH:
+			return "event to launch";
+		default:
+			return "unknown";
+	}
+}
+
+// Log our latency histograms (on SIGUSR1, and on exit)
+static void
+    dump_latency_histograms(void)
+{
+	LOG(LOG_NOTICE, "Latency histograms (bucket upper bound in us: samples):");
+	for (size_t watch_idx = 0U; watch_idx < watch_count; watch_idx++) {
+		for (LatencyStage stage = LAT_PROCESSED_CHECK; stage < LAT_STAGE_COUNT; stage++) {
+			const LatencyHistogram* hist = &watch_config[watch_idx].latency[stage];
+			if (hist->count == 0U) {
+				continue;
+			}
+
+			// Only list the buckets that actually have samples in them
+			char   buckets[LAT_BUCKET_COUNT * 24U] = { 0 };
+			size_t len                             = 0U;
+			for (size_t n = 0U; n < LAT_BUCKET_COUNT && len < sizeof(buckets); n++) {
+				if (hist->buckets[n] == 0U) {
+					continue;
+				}
+				if (n == LAT_BUCKET_COUNT - 1U) {
+					len += (size_t) snprintf(
+					    buckets + len, sizeof(buckets) - len, " +inf:%u", hist->buckets[n]);
+				} else {
+					len += (size_t) snprintf(
+					    buckets + len, sizeof(buckets) - len, " <%llu:%u", 1ULL << n, hist->buckets[n]);
+				}
+			}
+
+			LOG(LOG_NOTICE,
+			    "Watch idx %zu (%s) [%s]: %u samples, avg %lluus, max %lluus |%s",
+			    watch_idx,
+			    basename(watch_config[watch_idx].filename),
+			    get_latency_stage_name(stage),
+			    hist->count,
+			    (unsigned long long) (hist->total_us / hist->count),
+			    (unsigned long long) hist->max_us,
+			    buckets);
+		}
+		if (watch_config[watch_idx].coalesced_checks > 0U) {
+			LOG(LOG_NOTICE,
+			    "Watch idx %zu (%s): saved %zu checks by coalescing bursts of events",
+			    watch_idx,
+			    basename(watch_config[watch_idx].filename),
+			    watch_config[watch_idx].coalesced_checks);
+		}
+	}
+}
+
+// Map our binary event journal, creating or resetting it if need be
+static int
+    open_journal(void)
+{
+	int fd = open(KFMON_JOURNAL, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (fd == -1) {
+		perror("[KFMon] [WARN] open journal");
+		return -1;
+	}
+
+	size_t map_size = sizeof(JournalHeader) + KFMON_JOURNAL_CAPACITY * sizeof(JournalRecord);
+	// NOTE: This is a no-op if it's already the right size, and it zero-fills a new file.
+	if (ftruncate(fd, (off_t) map_size) == -1) {
+		perror("[KFMon] [WARN] ftruncate journal");
+		close(fd);
+		return -1;
+	}
+
+	void* map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	// NOTE: The mapping keeps the file alive, we don't need the fd anymore.
+	close(fd);
+	if (map == MAP_FAILED) {
+		perror("[KFMon] [WARN] mmap journal");
+		return -1;
+	}
+	journal.header   = (JournalHeader*) map;
+	journal.records  = (JournalRecord*) ((unsigned char*) map + sizeof(JournalHeader));
+	journal.map_size = map_size;
+
+	// Start from scratch if it's a new file, or one we can't make sense of
+	if (memcmp(journal.header->magic, KFMON_JOURNAL_MAGIC, sizeof(journal.header->magic)) != 0 ||
+	    journal.header->version != KFMON_JOURNAL_VERSION || journal.header->record_size != sizeof(JournalRecord) ||
+	    journal.header->capacity != KFMON_JOURNAL_CAPACITY) {
+		LOG(LOG_INFO, "Initializing a new event journal");
+		memset(map, 0, map_size);
+		memcpy(journal.header->magic, KFMON_JOURNAL_MAGIC, sizeof(journal.header->magic));
+		journal.header->version     = KFMON_JOURNAL_VERSION;
+		journal.header->record_size = (uint32_t) sizeof(JournalRecord);
+		journal.header->capacity    = KFMON_JOURNAL_CAPACITY;
+	}
+	LOG(LOG_INFO,
+	    "Event journal mapped from '%s' (%llu events logged so far)",
+	    KFMON_JOURNAL,
+	    (unsigned long long) journal.header->next);
+
+	return 0;
+}
+
+// Let go of our event journal (registered via atexit)
+static void
+    close_journal(void)
+{
+	if (journal.header) {
+		// NOTE: We don't msync on every record, that's the whole point, but we might as well do it on our way out.
+		msync(journal.header, journal.map_size, MS_SYNC);
+		munmap(journal.header, journal.map_size);
+		journal.header  = NULL;
+		journal.records = NULL;
+	}
+}
+
+// Record what happened for an inotify event in our journal (watch_idx is -1 if the event wasn't tied to a watch)
+static void
+    journal_event(ssize_t         watch_idx,
+		  uint32_t        mask,
+		  JournalDecision decision,
+		  uint64_t        check_us,
+		  uint64_t        spawn_us,
+		  pid_t           pid)
+{
+	if (!journal.header) {
+		return;
+	}
+
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	JournalRecord* rec = &journal.records[journal.header->next % KFMON_JOURNAL_CAPACITY];
+	rec->ts_ns         = (uint64_t) ts.tv_sec * 1000000000U + (uint64_t) ts.tv_nsec;
+	rec->watch_idx     = watch_idx < 0 ? UINT32_MAX : (uint32_t) watch_idx;
+	rec->mask          = mask;
+	rec->check_us      = (uint32_t) MIN(check_us, (uint64_t) UINT32_MAX);
+	rec->spawn_us      = (uint32_t) MIN(spawn_us, (uint64_t) UINT32_MAX);
+	rec->pid           = (int32_t) pid;
+	rec->decision      = (uint8_t) decision;
+	memset(rec->reserved, 0, sizeof(rec->reserved));
+	// NOTE: Only bump the counter once the record is complete, so the decoder never sees a half-written one.
+	journal.header->next++;
+}
+
+// Setup our control socket (c.f., control.h)
+static int
+    open_control_socket(void)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	if (strlen(KFMON_CONTROL_SOCKET) >= sizeof(addr.sun_path)) {
+		LOG(LOG_WARNING, "Control socket path '%s' is too long!", KFMON_CONTROL_SOCKET);
+		return -1;
+	}
+	strncpy(addr.sun_path, KFMON_CONTROL_SOCKET, sizeof(addr.sun_path) - 1U);    // Flawfinder: ignore
+
+	control_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (control_fd == -1) {
+		perror("[KFMon] [WARN] socket");
+		return -1;
+	}
+	// Clear the way if an earlier instance didn't get the chance to clean up after itself
+	unlink(KFMON_CONTROL_SOCKET);
+	// NOTE: It can be used to launch stuff, so it's for root's eyes only
+	mode_t orig_umask = umask(077);    // Flawfinder: ignore
+	int    ret        = bind(control_fd, (const struct sockaddr*) &addr, sizeof(addr));
+	umask(orig_umask);    // Flawfinder: ignore
+	if (ret == -1 || listen(control_fd, 4) == -1) {
+		perror("[KFMon] [WARN] bind/listen");
+		close(control_fd);
+		control_fd = -1;
+		return -1;
+	}
+
+	LOG(LOG_INFO, "Listening for commands on '%s'", KFMON_CONTROL_SOCKET);
+	return 0;
+}
+
+// And tear it down on our way out
+static void
+    close_control_socket(void)
+{
+	if (control_fd != -1) {
+		close(control_fd);
+		control_fd = -1;
+		unlink(KFMON_CONTROL_SOCKET);
+	}
+}
+
+// Append to a control reply, growing it as needed
+static void
+    control_printf(ControlReply* reply, const char* fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	int len = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+	if (len < 0) {
+		return;
+	}
+
+	if (reply->len + (size_t) len + 1U > reply->size) {
+		size_t new_size = MAX(reply->size ? reply->size * 2U : 1024U, reply->len + (size_t) len + 1U);
+		char*  new_buf  = realloc(reply->buf, new_size);
+		if (new_buf == NULL) {
+			perror("[KFMon] [WARN] realloc");
+			return;
+		}
+		reply->buf  = new_buf;
+		reply->size = new_size;
+	}
+
+	va_start(args, fmt);
+	vsnprintf(reply->buf + reply->len, reply->size - reply->len, fmt, args);
+	va_end(args);
+	reply->len += (size_t) len;
+}
+
+// Find the (live) watch a control command refers to: by idx, config file, or target file (full path or not).
+static ssize_t
+    find_watch_by_name(const char* name)
+{
+	char*         endptr;
+	unsigned long idx = strtoul(name, &endptr, 10);
+	if (*name != '\0' && *endptr == '\0') {
+		return (idx < watch_count && !watch_config[idx].is_retired) ? (ssize_t) idx : -1;
+	}
+
+	ssize_t found_idx = find_watch_by_filename(name);
+	if (found_idx == -1) {
+		found_idx = find_watch_by_config_file(name);
+	}
+	if (found_idx != -1) {
+		return found_idx;
+	}
+	// NOTE: That one's not indexed, but it's only ever used for interactive commands.
+	for (size_t watch_idx = 0U; watch_idx < watch_count; watch_idx++) {
+		if (!watch_config[watch_idx].is_retired && strcmp(basename(watch_config[watch_idx].filename), name) == 0) {
+			return (ssize_t) watch_idx;
+		}
+	}
+
+	return -1;
+}
+
+// list: What each of our watches is up to
+static void
+    control_list(ControlReply* reply)
+{
+	control_printf(reply, "OK\n");
+	for (size_t watch_idx = 0U; watch_idx < watch_count; watch_idx++) {
+		const WatchConfig* watch = &watch_config[watch_idx];
+		if (watch->is_retired) {
+			continue;
+		}
+
+		const char* armed;
+		if (watch->inotify_wd != -1) {
+			armed = "armed";
+		} else if (watch->parent_wd != -1) {
+			// Waiting for its target file to show up (c.f., handle_parent_event)
+			armed = "missing";
+		} else {
+			armed = "disarmed";
+		}
+
+		char  pid[24] = "-";
+		pid_t spid    = get_spawn_pid_for_watch(watch_idx);
+		if (spid != -1) {
+			snprintf(pid, sizeof(pid), "%ld", (long) spid);
+		}
+
+		char   flags[64] = { 0 };
+		size_t len       = 0U;
+		// NOTE: Every flag is a short, fixed string, so flags can't overflow.
+		//       Where it stands in its lifecycle (f.g., pending processing, or a deferred launch) is in state.
+		if (watch->fingerprint.is_valid) {
+			len += (size_t) snprintf(flags + len, sizeof(flags) - len, "%sprocessed", len ? "," : "");
+		}
+		if (watch->is_debouncing) {
+			len += (size_t) snprintf(flags + len, sizeof(flags) - len, "%sdebouncing", len ? "," : "");
+		}
+		if (watch->block_spawns) {
+			len += (size_t) snprintf(flags + len, sizeof(flags) - len, "%sblocker", len ? "," : "");
+		}
+
+		// NOTE: The cgroup (if any) comes last in there, it's where our action will actually end up.
+		char spawn_attrs[KFMON_PATH_MAX + 256U];
+		format_spawn_attrs(&watch->spawn_attrs, spawn_attrs, sizeof(spawn_attrs));
+
+		control_printf(reply,
+			       "%zu\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n",
+			       watch_idx,
+			       armed,
+			       get_watch_state_name(watch->state),
+			       pid,
+			       len ? flags : "-",
+			       watch->config_file,
+			       watch->filename,
+			       watch->action,
+			       spawn_attrs);
+	}
+}
+
+// stats: Our counters
+static void
+    control_stats(ControlReply* reply)
+{
+	control_printf(reply, "OK\n");
+	control_printf(reply, "db_queries\t%lu\n", db_stats.queries);
+	control_printf(reply, "db_legacy_queries\t%lu\n", db_stats.legacy_queries);
+	if (journal.header) {
+		control_printf(reply, "journal_events\t%llu\n", (unsigned long long) journal.header->next);
+	}
+	for (size_t watch_idx = 0U; watch_idx < watch_count; watch_idx++) {
+		const WatchConfig* watch = &watch_config[watch_idx];
+		if (watch->is_retired) {
+			continue;
+		}
+
+		control_printf(reply, "watch\t%zu\tspawns\t%zu\n", watch_idx, watch->spawn_count);
+		control_printf(reply, "watch\t%zu\tcoalesced checks\t%zu\n", watch_idx, watch->coalesced_checks);
+		for (LatencyStage stage = LAT_PROCESSED_CHECK; stage < LAT_STAGE_COUNT; stage++) {
+			const LatencyHistogram* hist = &watch->latency[stage];
+			if (hist->count == 0U) {
+				continue;
+			}
+			control_printf(reply,
+				       "watch\t%zu\t%s\t%u samples\tavg %lluus\tmax %lluus\n",
+				       watch_idx,
+				       get_latency_stage_name(stage),
+				       hist->count,
+				       (unsigned long long) (hist->total_us / hist->count),
+				       (unsigned long long) hist->max_us);
+		}
+	}
+}
+
+// trigger: Launch a watch's action right away, without going anywhere near Nickel's DB
+// NOTE: We still won't launch a second instance of it, nor anything while a spawn blocker is running, though.
+static void
+    control_trigger(ControlReply* reply, const char* name)
+{
+	if (name == NULL) {
+		control_printf(reply, "ERR: Usage: trigger <watch>\n");
+		return;
+	}
+	ssize_t found_idx = find_watch_by_name(name);
+	if (found_idx == -1) {
+		control_printf(reply, "ERR: No such watch: '%s'\n", name);
+		return;
+	}
+	size_t watch_idx = (size_t) found_idx;
+
+	JournalDecision decision = JOURNAL_NONE;
+	uint64_t        spawn_us = 0U;
+	pid_t           spid     = -1;
+	if (is_watch_already_spawned(watch_idx)) {
+		decision = JOURNAL_BUSY;
+		control_printf(reply,
+			       "ERR: %s is still running (pid %ld)\n",
+			       watch_config[watch_idx].action,
+			       (long) get_spawn_pid_for_watch(watch_idx));
+	} else if (is_blocker_running()) {
+		decision = JOURNAL_BLOCKED;
+		control_printf(reply, "ERR: A spawn blocker is currently running\n");
+	} else {
+		LOG(LOG_NOTICE,
+		    "Triggering watch idx %zu (%s) on request, skipping the usual checks",
+		    watch_idx,
+		    watch_config[watch_idx].filename);
+		// NOTE: Our request is the event, as far as our latency stats are concerned
+		get_monotonic_time(&event_ts);
+		spid     = launch_watch(watch_idx, &spawn_us);
+		decision = spid == -1 ? JOURNAL_FAILED : JOURNAL_SPAWNED;
+		if (spid == -1) {
+			control_printf(reply, "ERR: Failed to launch %s\n", watch_config[watch_idx].action);
+		} else {
+			control_printf(reply, "OK\n%ld\n", (long) spid);
+		}
+	}
+	journal_event(found_idx, 0U, decision, 0U, spawn_us, spid);
+}
+
+// Someone's knocking on our control socket
+static void
+    handle_control_connection(void)
+{
+	int cfd = accept4(control_fd, NULL, NULL, SOCK_CLOEXEC);
+	if (cfd == -1) {
+		if (errno != EAGAIN && errno != ECONNABORTED) {
+			perror("[KFMon] [WARN] accept4");
+		}
+		return;
+	}
+	const struct timeval timeout = { 0L, CONTROL_TIMEOUT_MS * 1000L };
+	if (setsockopt(cfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == -1 ||
+	    setsockopt(cfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) == -1) {
+		perror("[KFMon] [WARN] setsockopt");
+		close(cfd);
+		return;
+	}
+
+	// Read a single line
+	char   cmd[KFMON_CONTROL_CMD_MAX];
+	size_t len = 0U;
+	while (len < sizeof(cmd) - 1U) {
+		ssize_t nread = read(cfd, cmd + len, sizeof(cmd) - 1U - len);    // Flawfinder: ignore
+		if (nread == -1 && errno == EINTR) {
+			continue;
+		}
+		if (nread <= 0) {
+			break;
+		}
+		len += (size_t) nread;
+		if (memchr(cmd, '\n', len) != NULL) {
+			break;
+		}
+	}
+	cmd[len] = '\0';
+	cmd[strcspn(cmd, "\r\n")] = '\0';
+
+	// The verb is the first word, and its argument (if any) is the rest of the line,
+	// as it may very well be a filename with spaces in it.
+	ControlReply reply = { 0 };
+	char*        verb  = cmd + strspn(cmd, " \t");
+	char*        arg   = verb + strcspn(verb, " \t");
+	if (*arg != '\0') {
+		*arg++ = '\0';
+		arg += strspn(arg, " \t");
+	}
+	if (*verb == '\0') {
+		verb = NULL;
+	}
+	if (*arg == '\0') {
+		arg = NULL;
+	}
+	if (verb == NULL) {
+		control_printf(&reply, "ERR: Empty command\n");
+	} else if (strcmp(verb, "list") == 0) {
+		control_list(&reply);
+	} else if (strcmp(verb, "stats") == 0) {
+		control_stats(&reply);
+	} else if (strcmp(verb, "trigger") == 0) {
+		control_trigger(&reply, arg);
+	} else {
+		control_printf(&reply, "ERR: Unknown command '%s' (try list, stats or trigger <watch>)\n", verb);
+	}
+	DBGLOG("Control command '%s' -> %zu bytes of reply", verb ? verb : "", reply.len);
+
+	// Send it all back, and hang up
+	for (size_t sent = 0U; sent < reply.len;) {
+		ssize_t nwritten = send(cfd, reply.buf + sent, reply.len - sent, MSG_NOSIGNAL);
+		if (nwritten == -1 && errno == EINTR) {
+			continue;
+		}
+		if (nwritten <= 0) {
+			perror("[KFMon] [WARN] send");
+			break;
+		}
+		sent += (size_t) nwritten;
+	}
+	free(reply.buf);
+	close(cfd);
+}
+
+// Set up our signal handling, which happens synchronously, from the main poll loop, via a signalfd.
+// That includes our child reaping machinery: we reap either via a pidfd per child,
+// or, on kernels that predate pidfd_open (i.e., < 5.3, which means every Kobo kernel to date),
+// via SIGCHLD.
+static int
+    init_signals(void)
+{
+	// Block the signals we'll be handling synchronously
+	// NOTE: SIGCHLD is always blocked, it's simply left pending w/ pidfds.
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	sigaddset(&mask, SIGUSR1);
+	// NOTE: daemonize left SIGHUP ignored, but a blocked signal is still queued, so we'll see it on our signalfd.
+	sigaddset(&mask, SIGHUP);
+	sigaddset(&mask, SIGTERM);
+	sigaddset(&mask, SIGINT);
+	if (sigprocmask(SIG_BLOCK, &mask, &orig_sigmask) == -1) {
+		perror("[KFMon] [ERR!] sigprocmask");
+		return -1;
+	}
+
+	// Check if the kernel supports pidfds...
+	int pidfd = (int) syscall(SYS_pidfd_open, getpid(), 0);
+	if (pidfd != -1) {
+		close(pidfd);
+		use_pidfd = true;
+		sigdelset(&mask, SIGCHLD);
+		LOG(LOG_INFO, "Reaping our spawns via pidfds");
+	} else {
+		LOG(LOG_INFO, "Reaping our spawns via SIGCHLD");
+	}
+
+	signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (signal_fd == -1) {
+		perror("[KFMon] [ERR!] signalfd");
+		return -1;
+	}
+
+	return 0;
+}
+
+// Handle whatever signals were caught since the last time we checked
+static void
+    handle_signals(void)
+{
+	struct signalfd_siginfo si;
+	bool                    got_sigchld = false;
+	bool                    got_sigusr1 = false;
+	// NOTE: Standard signals don't queue, so one SIGCHLD may stand for several dead children.
+	while (read(signal_fd, &si, sizeof(si)) == sizeof(si)) {    // Flawfinder: ignore
+		switch (si.ssi_signo) {
+			case SIGCHLD:
+				got_sigchld = true;
+				break;
+			case SIGUSR1:
+				got_sigusr1 = true;
+				break;
+			case SIGHUP:
+				// NOTE: We'll need our inotify fd to re-arm our watches, so that's left to our caller.
+				LOG(LOG_NOTICE, "Caught SIGHUP, reloading our configs");
+				config_reload_requested = true;
+				break;
+			case SIGTERM:
+			case SIGINT:
+				// NOTE: Our atexit handler will take care of dumping our stats.
+				LOG(LOG_NOTICE, "Caught signal %u (%s), exiting", si.ssi_signo, strsignal((int) si.ssi_signo));
+				exit(EXIT_SUCCESS);
+			default:
+				break;
+		}
+	}
+
+	if (got_sigchld) {
+		reap_children();
+	}
+	if (got_sigusr1) {
+		dump_latency_histograms();
+	}
+}
+
+// Recap what happened to a spawn that just died, and forget about it.
+static void
+    reap_process(size_t i, int wstatus)
+{
+	pid_t  cpid      = PT.spawn_pids[i];
+	size_t watch_idx = (size_t) PT.spawn_watchids[i];
+
+	if (WIFEXITED(wstatus)) {
+		int exitcode = WEXITSTATUS(wstatus);
+		// NOTE: execvp() failures are caught & reported by spawn() itself, so this is the actual exit code.
+		LOG(exitcode == 0 ? LOG_NOTICE : LOG_WARNING,
+		    "Reaped process %ld (from watch idx %zu): It exited with status %d.",
+		    (long) cpid,
+		    watch_idx,
+		    exitcode);
+	} else if (WIFSIGNALED(wstatus)) {
+		int sigcode = WTERMSIG(wstatus);
+		LOG(LOG_WARNING,
+		    "Reaped process %ld (from watch idx %zu): It was killed by signal %d (%s)",
+		    (long) cpid,
+		    watch_idx,
+		    sigcode,
+		    strsignal(sigcode));
+		notify("[KFMon] PID %ld was killed by signal %d!", (long) cpid, sigcode);
+	}
+
+	// We won't be needing its pidfd anymore
+	if (PT.spawn_pidfds[i] != -1) {
+		close(PT.spawn_pidfds[i]);
+		PT.spawn_pidfds[i] = -1;
+	}
+
+	// And now we can safely remove it from the process table
+	remove_process_from_table(i);
+}
+
+// Reap the spawn behind process table entry i, whose pidfd just became readable (i.e., it died).
+static void
+    handle_pidfd(size_t i)
+{
+	pid_t ret;
+	int   wstatus;
+	do {
+		ret = waitpid(PT.spawn_pids[i], &wstatus, WNOHANG);
+	} while (ret == -1 && errno == EINTR);
+
+	if (ret == -1) {
+		perror("[KFMon] [CRIT] waitpid");
+		return;
+	}
+	if (ret == PT.spawn_pids[i]) {
+		reap_process(i, wstatus);
+	}
+}
+
+// Reap every spawn that died since the last time we caught a SIGCHLD.
+static void
+    reap_children(void)
+{
+	pid_t ret;
+	int   wstatus;
+	for (;;) {
+		ret = waitpid(-1, &wstatus, WNOHANG);
+		if (ret == -1 && errno == EINTR) {
+			continue;
+		}
+		// 0 means nothing else to reap, -1 w/ ECHILD means we don't have any children left.
+		if (ret <= 0) {
+			if (ret == -1 && errno != ECHILD) {
+				perror("[KFMon] [CRIT] waitpid");
+			}
+			break;
+		}
+		// Our launcher died, we'll notice its end of the socket going away, too (c.f., lose_launcher)
+		if (ret == launcher_pid) {
+			launcher_pid = -1;
+			continue;
+		}
+
+		// Find it in our process table...
+		bool found = false;
+		for (size_t i = 0; i < PT.size; i++) {
+			if (PT.spawn_pids[i] == ret) {
+				reap_process(i, wstatus);
+				found = true;
+				break;
+			}
+		}
+		if (!found) {
+			LOG(LOG_WARNING, "Reaped unknown process %ld", (long) ret);
+		}
+	}
+}
+
+// Fork our launcher, which will fork + exec our spawns on our behalf from then on (c.f., run_launcher).
+// NOTE: This has to happen early, before we start any thread, open Nickel's DB, or initialize FBInk,
+//       while we're as small as we'll ever be: that's what keeps its own forks cheap,
+//       and it means we never have to fork a process that has grown those, ourselves.
+static int
+    start_launcher(void)
+{
+	int sv[2];
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == -1) {
+		perror("[KFMon] [WARN] socketpair");
+		return -1;
+	}
+
+	pid_t pid = fork();
+	if (pid == -1) {
+		perror("[KFMon] [WARN] fork");
+		close(sv[0]);
+		close(sv[1]);
+		return -1;
+	} else if (pid == 0) {
+		close(sv[0]);
+		run_launcher(sv[1]);
+	}
+
+	close(sv[1]);
+	launcher_fd  = sv[0];
+	launcher_pid = pid;
+	LOG(LOG_INFO, "Started our launcher (pid %ld)", (long) pid);
+	return 0;
+}
+
+// Our launcher's main loop: spawn what we're asked to, and report back when those spawns die.
+// NOTE: It's single-threaded, never touches SQLite or FBInk, and only ever logs synchronously.
+//       It goes away when KFMon does (i.e., when its end of the socket is closed).
+static void
+    run_launcher(int sock)
+{
+	// So that it's easy to tell apart from KFMon itself (f.g., by pkill -x kfmon)
+	prctl(PR_SET_NAME, "kfmon-launcher", 0, 0, 0);
+	// We don't need this one
+	close(mount_state.fd);
+
+	// Reap our spawns via a signalfd, too
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	if (sigprocmask(SIG_BLOCK, &mask, &orig_sigmask) == -1) {
+		perror("[KFMon] [ERR!] Aborting launcher: sigprocmask");
+		_exit(EXIT_FAILURE);
+	}
+	int sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (sfd == -1) {
+		perror("[KFMon] [ERR!] Aborting launcher: signalfd");
+		_exit(EXIT_FAILURE);
+	}
+
+	struct pollfd pfds[] = { { .fd = sock, .events = POLLIN }, { .fd = sfd, .events = POLLIN } };
+	for (;;) {
+		if (poll(pfds, sizeof(pfds) / sizeof(*pfds), -1) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("[KFMon] [ERR!] Aborting launcher: poll");
+			break;
+		}
+
+		// NOTE: A spawn's death is always reported *after* its launch, since we only reap between requests.
+		if (pfds[1].revents & POLLIN) {
+			struct signalfd_siginfo si;
+			while (read(sfd, &si, sizeof(si)) == sizeof(si)) {    // Flawfinder: ignore
+				;
+			}
+			LauncherReply reply = { .type = LAUNCHER_EXITED };
+			while ((reply.pid = waitpid(-1, &reply.status, WNOHANG)) > 0) {
+				if (send(sock, &reply, sizeof(reply), MSG_NOSIGNAL) == -1) {
+					perror("[KFMon] [WARN] launcher: send");
+				}
+			}
+		}
+
+		if (pfds[0].revents & POLLIN) {
+			LauncherRequest request;
+			ssize_t         len = recv(sock, &request, sizeof(request), 0);
+			if (len == 0) {
+				// KFMon is gone, and so are we
+				break;
+			} else if (len != sizeof(request)) {
+				if (len == -1 && errno == EINTR) {
+					continue;
+				}
+				perror("[KFMon] [ERR!] Aborting launcher: recv");
+				break;
+			}
+			request.action[sizeof(request.action) - 1U]             = '\0';
+			request.attrs.cgroup[sizeof(request.attrs.cgroup) - 1U] = '\0';
+
+			char* const   cmd[] = { request.action, NULL };
+			LauncherReply reply = { .type = LAUNCHER_SPAWNED, .watch_idx = request.watch_idx };
+			reply.pid           = fork_exec(cmd, &request.attrs, &reply.status);
+			if (send(sock, &reply, sizeof(reply), MSG_NOSIGNAL) == -1) {
+				perror("[KFMon] [WARN] launcher: send");
+			}
+		} else if (pfds[0].revents & (POLLHUP | POLLERR)) {
+			break;
+		}
+	}
+
+	// NOTE: _exit, not exit: the atexit handlers we inherited are KFMon's business, not ours.
+	_exit(EXIT_SUCCESS);
+}
+
+// Let our launcher know we're going away (registered via atexit)
+static void
+    stop_launcher(void)
+{
+	if (launcher_fd != -1) {
+		close(launcher_fd);
+		launcher_fd = -1;
+	}
+}
+
+// Our launcher died on us: go back to launching things ourselves.
+static void
+    lose_launcher(void)
+{
+	LOG(LOG_ERR, "Lost our launcher, we'll launch things ourselves from now on");
+	close(launcher_fd);
+	launcher_fd = -1;
+	// Don't leave it as a zombie (unless our SIGCHLD handling beat us to it)
+	if (launcher_pid != -1) {
+		while (waitpid(launcher_pid, NULL, 0) == -1 && errno == EINTR) {
+			;
+		}
+		launcher_pid = -1;
+	}
+
+	// Its spawns were reparented to init, we won't ever hear about them again.
+	// NOTE: Until now, every spawn went through it, so that's everything in our process table.
+	for (size_t i = 0U; i < PT.size; i++) {
+		if (PT.spawn_pids[i] != -1) {
+			LOG(LOG_WARNING,
+			    "Lost track of process %ld (from watch idx %zd)",
+			    (long) PT.spawn_pids[i],
+			    PT.spawn_watchids[i]);
+			remove_process_from_table(i);
+		}
+	}
+}
+
+// Ask our launcher to spawn command, for a given watch.
+// Returns false if we don't have a launcher (anymore), otherwise, the reply is in *pid & *err (c.f., fork_exec).
+static bool
+    launch_via_launcher(const char* command, size_t watch_idx, pid_t* pid, int* err)
+{
+	if (launcher_fd == -1) {
+		return false;
+	}
+
+	LauncherRequest request = { .watch_idx = (uint32_t) watch_idx, .attrs = watch_config[watch_idx].spawn_attrs };
+	strncpy(request.action, command, sizeof(request.action) - 1U);    // Flawfinder: ignore
+	if (send(launcher_fd, &request, sizeof(request), MSG_NOSIGNAL) == -1) {
+		perror("[KFMon] [WARN] send");
+		lose_launcher();
+		return false;
+	}
+
+	// Wait for its reply, handling the deaths it may report in the meantime
+	for (;;) {
+		LauncherReply reply;
+		ssize_t       len = recv(launcher_fd, &reply, sizeof(reply), 0);
+		if (len == -1 && errno == EINTR) {
+			continue;
+		}
+		if (len != sizeof(reply)) {
+			// NOTE: It may very well have spawned it before dying, so don't try again behind its back.
+			*err = len == -1 ? errno : EPIPE;
+			*pid = -1;
+			lose_launcher();
+			return true;
+		}
+		if (reply.type == LAUNCHER_SPAWNED) {
+			*pid = reply.pid;
+			*err = reply.status;
+			return true;
+		}
+		handle_launcher_reply(&reply);
+	}
+}
+
+// Handle a spontaneous message from our launcher
+static void
+    handle_launcher_reply(const LauncherReply* reply)
+{
+	if (reply->type != LAUNCHER_EXITED) {
+		LOG(LOG_WARNING, "Unexpected reply from our launcher (type %u, pid %ld)", reply->type, (long) reply->pid);
+		return;
+	}
+
+	// Find it in our process table...
+	for (size_t i = 0U; i < PT.size; i++) {
+		if (PT.spawn_pids[i] == reply->pid) {
+			reap_process(i, reply->status);
+			return;
+		}
+	}
+	LOG(LOG_WARNING, "Our launcher reaped unknown process %ld", (long) reply->pid);
+}
+
+// Our launcher has something to tell us (or it died)
+static void
+    handle_launcher(void)
+{
+	for (;;) {
+		LauncherReply reply;
+		ssize_t       len = recv(launcher_fd, &reply, sizeof(reply), MSG_DONTWAIT);
+		if (len == -1 && errno == EINTR) {
+			continue;
+		}
+		if (len == -1 && errno == EAGAIN) {
+			return;
+		}
+		if (len != sizeof(reply)) {
+			if (len == -1) {
+				perror("[KFMon] [WARN] recv");
+			}
+			lose_launcher();
+			return;
+		}
+		handle_launcher_reply(&reply);
+	}
+}
+
+static const char*
+    get_spawn_attr_name(uint32_t flag)
+{
+	switch (flag) {
+		case SPAWN_EXEC:
+			return "execvp";
+		case SPAWN_NICE:
+			return "nice";
+		case SPAWN_SCHED:
+			return "sched_policy";
+		case SPAWN_IOPRIO:
+		case SPAWN_IOPRIO_LEVEL:
+			return "ioprio_class";
+		case SPAWN_CPU_AFFINITY:
+			return "cpu_affinity";
+		case SPAWN_OOM_SCORE_ADJ:
+			return "oom_score_adj";
+		case SPAWN_RLIMITS:
+			return "rlimits";
+		case SPAWN_CGROUP:
+			return "cgroup";
+		default:
+			return "unknown";
+	}
+}
+
+// Append a comma-separated item to buf, truncating it if need be (in which case it's always left NUL-terminated).
+static void
+    append_spawn_attr(char* buf, size_t size, size_t* len, const char* fmt, ...)
+{
+	if (*len > 0U && *len < size - 1U) {
+		buf[(*len)++] = ',';
+		buf[*len]     = '\0';
+	}
+	va_list args;
+	va_start(args, fmt);
+	int ret = vsnprintf(buf + *len, size - *len, fmt, args);
+	va_end(args);
+	// NOTE: vsnprintf returns what it *would* have written, so clamp that, in order to never run past the end.
+	if (ret > 0) {
+		*len = MIN(*len + (size_t) ret, size - 1U);
+	}
+}
+
+// Recap a watch's SpawnAttrs in a compact, human-readable form (f.g., nice=5,sched=batch,io=idle), or "-" if none.
+static void
+    format_spawn_attrs(const SpawnAttrs* attrs, char* buf, size_t size)
+{
+	static const char* const sched_names[] = {
+		[SCHED_OTHER] = "other", [SCHED_FIFO] = "fifo", [SCHED_RR] = "rr",
+		[SCHED_BATCH] = "batch", [SCHED_IDLE] = "idle",
+	};
+	static const char* const ioprio_names[] = {
+		[IOPRIO_CLASS_RT] = "rt", [IOPRIO_CLASS_BE] = "be", [IOPRIO_CLASS_IDLE] = "idle",
+	};
+
+	size_t len = 0U;
+	buf[0]     = '\0';
+	if (attrs->mask & SPAWN_NICE) {
+		append_spawn_attr(buf, size, &len, "nice=%d", attrs->nice);
+	}
+	if (attrs->mask & SPAWN_SCHED) {
+		append_spawn_attr(buf, size, &len, "sched=%s", sched_names[attrs->sched_policy]);
+		if (attrs->sched_priority != 0) {
+			append_spawn_attr(buf, size, &len, "prio=%d", attrs->sched_priority);
+		}
+	}
+	if (attrs->mask & SPAWN_IOPRIO) {
+		append_spawn_attr(buf, size, &len, "io=%s", ioprio_names[attrs->ioprio_class]);
+		if (attrs->mask & SPAWN_IOPRIO_LEVEL) {
+			append_spawn_attr(buf, size, &len, "iolevel=%d", attrs->ioprio_level);
+		}
+	}
+	if (attrs->mask & SPAWN_CPU_AFFINITY) {
+		append_spawn_attr(buf, size, &len, "cpus=0x%llx", (unsigned long long) attrs->cpu_affinity);
+	}
+	if (attrs->mask & SPAWN_OOM_SCORE_ADJ) {
+		append_spawn_attr(buf, size, &len, "oom=%d", attrs->oom_score_adj);
+	}
+	for (size_t i = 0U; i < sizeof(rlimit_keys) / sizeof(*rlimit_keys); i++) {
+		const struct rlimit* limit = &attrs->rlimits[rlimit_keys[i].resource];
+		// Skip the rlimit_ prefix
+		const char* name = rlimit_keys[i].key + sizeof("rlimit_") - 1U;
+		if (!(attrs->rlimit_mask & (1U << rlimit_keys[i].resource))) {
+			continue;
+		}
+		if (limit->rlim_cur == RLIM_INFINITY) {
+			append_spawn_attr(buf, size, &len, "%s=unlimited", name);
+		} else {
+			append_spawn_attr(buf, size, &len, "%s=%llu", name, (unsigned long long) limit->rlim_cur);
+		}
+	}
+	if (attrs->mask & SPAWN_CGROUP) {
+		append_spawn_attr(buf, size, &len, "cgroup=%s", attrs->cgroup);
+	}
+	if (len == 0U) {
+		snprintf(buf, size, "%s", "-");
+	}
+}
+
+// Prepare everything apply_spawn_attrs will need, since it can't do much more than syscalls (c.f., fork_exec).
+// That includes creating the cgroup, if need be.
+static int
+    prepare_spawn_attrs(const SpawnAttrs* attrs, SpawnPrep* prep)
+{
+	if (attrs->mask & SPAWN_CGROUP) {
+		// mkdir -p
+		char path[sizeof(prep->cgroup_procs)];
+		int  len = snprintf(path, sizeof(path), "%s/%s", KFMON_CGROUP_ROOT, attrs->cgroup);
+		if (len < 0 || (size_t) len >= sizeof(path)) {
+			errno = ENAMETOOLONG;
+			return -1;
+		}
+		for (char* p = path + sizeof(KFMON_CGROUP_ROOT);; p++) {
+			if (*p != '/' && *p != '\0') {
+				continue;
+			}
+			char c = *p;
+			*p     = '\0';
+			if (mkdir(path, 0755) == -1 && errno != EEXIST) {
+				LOG(LOG_ERR, "Failed to create cgroup '%s': %m", path);
+				return -1;
+			}
+			*p = c;
+			if (c == '\0') {
+				break;
+			}
+		}
+		snprintf(prep->cgroup_procs, sizeof(prep->cgroup_procs), "%s/cgroup.procs", path);
+	}
+	if (attrs->mask & SPAWN_OOM_SCORE_ADJ) {
+		prep->oom_score_adj_len =
+		    (size_t) snprintf(prep->oom_score_adj, sizeof(prep->oom_score_adj), "%d", attrs->oom_score_adj);
+	}
+	if (attrs->mask & SPAWN_CPU_AFFINITY) {
+		CPU_ZERO(&prep->cpu_set);
+		for (int cpu = 0; cpu < 64; cpu++) {
+			if (attrs->cpu_affinity & ((uint64_t) 1U << cpu)) {
+				CPU_SET((size_t) cpu, &prep->cpu_set);
+			}
+		}
+	}
+	if (attrs->mask & SPAWN_IOPRIO) {
+		// NOTE: Like ionice, default to the middle of the pack. The level is meaningless for the idle class.
+		int level    = (attrs->mask & SPAWN_IOPRIO_LEVEL) ? attrs->ioprio_level : 4;
+		if (attrs->ioprio_class == IOPRIO_CLASS_IDLE) {
+			level = 0;
+		}
+		prep->ioprio = (attrs->ioprio_class << IOPRIO_CLASS_SHIFT) | level;
+	}
+
+	return 0;
+}
+
+// Apply a watch's SpawnAttrs to the current process, returning 0, or the SpawnAttrFlag that failed (w/ errno set).
+// NOTE: This runs in a vfork child, so it sticks to async-safe syscalls, and never writes to memory it doesn't own.
+//       The cgroup comes first, so that nothing we do after that is accounted to our own,
+//       and the rlimits come last, since they might very well prevent us from doing the rest.
+static uint32_t
+    apply_spawn_attrs(const SpawnAttrs* attrs, const SpawnPrep* prep)
+{
+	if (attrs->mask & SPAWN_CGROUP) {
+		// NOTE: Writing 0 to cgroup.procs moves the writer itself.
+		int fd = open(prep->cgroup_procs, O_WRONLY | O_CLOEXEC);
+		if (fd == -1 || write(fd, "0", 1U) != 1) {
+			return SPAWN_CGROUP;
+		}
+		close(fd);
+	}
+	if (attrs->mask & SPAWN_OOM_SCORE_ADJ) {
+		int fd = open("/proc/self/oom_score_adj", O_WRONLY | O_CLOEXEC);
+		if (fd == -1 ||
+		    write(fd, prep->oom_score_adj, prep->oom_score_adj_len) != (ssize_t) prep->oom_score_adj_len) {
+			return SPAWN_OOM_SCORE_ADJ;
+		}
+		close(fd);
+	}
+	if ((attrs->mask & SPAWN_CPU_AFFINITY) && sched_setaffinity(0, sizeof(prep->cpu_set), &prep->cpu_set) == -1) {
+		return SPAWN_CPU_AFFINITY;
+	}
+	if (attrs->mask & SPAWN_SCHED) {
+		const struct sched_param param = { .sched_priority = attrs->sched_priority };
+		if (sched_setscheduler(0, attrs->sched_policy, &param) == -1) {
+			return SPAWN_SCHED;
+		}
+	}
+	if ((attrs->mask & SPAWN_NICE) && setpriority(PRIO_PROCESS, 0, attrs->nice) == -1) {
+		return SPAWN_NICE;
+	}
+	if ((attrs->mask & SPAWN_IOPRIO) && syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, prep->ioprio) == -1) {
+		return SPAWN_IOPRIO;
+	}
+	if (attrs->mask & SPAWN_RLIMITS) {
+		for (int resource = 0; resource < RLIM_NLIMITS; resource++) {
+			if (!(attrs->rlimit_mask & (1U << resource))) {
+				continue;
+			}
+			if (setrlimit(resource, &attrs->rlimits[resource]) == -1) {
+				return SPAWN_RLIMITS;
+			}
+		}
+	}
+
+	return SPAWN_EXEC;
+}
+
+// fork + exec command, and return its pid (or -1 if it failed to launch, w/ the reason in *err).
+// Initially inspired from popen2() implementations from https://stackoverflow.com/questions/548063
+// As well as the glibc's system() call.
+// NOTE: We use vfork, because we don't need to duplicate our page tables (SQLite's cache, FBInk's mappings...)
+//       just to exec something else right away, which is a real concern on low-RAM devices.
+//       posix_spawn would be nicer, but it only reports exec failures synchronously since glibc 2.24,
+//       (it used to be a fork + exit(127) affair), and Kobo TCs have been shipping older glibc versions,
+//       so we roll our own, with a CLOEXEC pipe to get execvp's errno back.
+// NOTE: This is also what our launcher runs, so it only ever logs, it's up to the caller to handle the rest.
+// NOTE: The watch's SpawnAttrs are applied in the child, right before it execs (c.f., apply_spawn_attrs).
+static pid_t
+    fork_exec(char* const* command, const SpawnAttrs* attrs, int* err)
+{
+	SpawnPrep prep;
+	if (prepare_spawn_attrs(attrs, &prep) == -1) {
+		*err = errno;
+		return -1;
+	}
+
+	// NOTE: If execvp() succeeds, the write end is closed on exec, and our read returns 0 bytes.
+	//       If it fails (or setting things up for it did), the child sends us what & errno over it before dying.
+	int errpipe[2];
+	if (pipe2(errpipe, O_CLOEXEC) == -1) {
+		*err = errno;
+		perror("[KFMon] [ERR!] pipe2");
+		return -1;
+	}
+
+	pid_t pid = vfork();
+
+	if (pid < 0) {
+		// Fork failed?
+		*err = errno;
+		perror("[KFMon] [ERR!] vfork");
+		close(errpipe[0]);
+		close(errpipe[1]);
+		return -1;
+	} else if (pid == 0) {
+		// Sweet child o' mine!
+		// NOTE: We share our parent's memory until execve(), so we can only use async-safe functions,
+		//       we can't touch any of its variables, and we can't return: it's _exit() or bust!
+		// Do the whole stdin/stdout/stderr dance again,
+		// to ensure that child process doesn't inherit our tweaked fds...
+		dup2(orig_stdin, STDIN_FILENO);
+		dup2(orig_stdout, STDOUT_FILENO);
+		dup2(orig_stderr, STDERR_FILENO);
+		close(orig_stdin);
+		close(orig_stdout);
+		close(orig_stderr);
+		// Restore signals
+		// NOTE: Signal dispositions & masks are per-process, so this doesn't affect our parent.
+		signal(SIGHUP, SIG_DFL);
+		sigprocmask(SIG_SETMASK, &orig_sigmask, NULL);
+		// Set things up as requested by this watch's config
+		SpawnError child_err = { .stage = apply_spawn_attrs(attrs, &prep) };
+		if (child_err.stage == SPAWN_EXEC) {
+			// NOTE: We used to use execvpe when being launched from udev,
+			//       in order to sanitize all the crap we inherited from udev's env ;).
+			//       Now, we actually rely on the specific env we inherit from rcS/on-animator!
+			execvp(*command, command);
+		}
+		// NOTE: This will only ever be reached on error, hence the lack of actual return value check ;).
+		//       Let our parent know why.
+		child_err.err                         = errno;
+		ssize_t __attribute__((unused)) wrote = write(errpipe[1], &child_err, sizeof(child_err));
+		_exit(127);
+	}
+
+	// Parent
+	close(errpipe[1]);
+
+	// Check how execvp() fared...
+	SpawnError child_err;
+	ssize_t    nread;
+	do {
+		nread = read(errpipe[0], &child_err, sizeof(child_err));    // Flawfinder: ignore
+	} while (nread == -1 && errno == EINTR);
+	close(errpipe[0]);
+
+	if (nread == sizeof(child_err)) {
+		// It failed, reap our stillborn child right now, it's either already dead, or about to be.
+		int wstatus;
+		while (waitpid(pid, &wstatus, 0) == -1 && errno == EINTR) {
+			;
+		}
+		if (child_err.stage != SPAWN_EXEC) {
+			LOG(LOG_ERR,
+			    "Failed to apply %s to %s: %s",
+			    get_spawn_attr_name(child_err.stage),
+			    *command,
+			    strerror(child_err.err));
+		}
+		*err = child_err.err;
+		return -1;
+	}
+
+	return pid;
+}
+
+// Spawn a watch's action and return its pid (or -1 if it failed to launch)...
+// With a bit of added tracking to handle reaping from our main loop.
+// NOTE: That's left to our launcher if we have one (c.f., start_launcher), otherwise, we fork ourselves.
+static pid_t
+    spawn(char* const* command, size_t watch_idx)
+{
+	struct timespec spawn_ts;
+	get_monotonic_time(&spawn_ts);
+
+	pid_t pid;
+	int   err         = 0;
+	bool  is_launched = launch_via_launcher(*command, watch_idx, &pid, &err);
+	if (!is_launched) {
+		pid = fork_exec(command, &watch_config[watch_idx].spawn_attrs, &err);
+	}
+	if (pid == -1) {
+		LOG(LOG_ERR,
+		    "Failed to launch %s (from watch idx %zu): %s.",
+		    watch_config[watch_idx].action,
+		    watch_idx,
+		    strerror(err));
+		notify("[KFMon] Failed to launch %s: %s!", basename(watch_config[watch_idx].action), strerror(err));
+		return -1;
+	}
+
+	// It's alive!
+	record_latency(watch_idx, LAT_SPAWN, &spawn_ts);
+	record_latency(watch_idx, LAT_EVENT_TO_LAUNCH, &event_ts);
+
+	// Keep track of the process
+	ssize_t i = get_next_available_pt_entry();
+	if (i < 0) {
+		// NOTE: If we ever hit this error codepath,
+		//       we don't have to worry about leaving that last spawn as a zombie:
+		//       One of the benefits of the double-fork we do to daemonize is that, on our death,
+		//       our children will get reparented to init, which, by design,
+		//       will handle the reaping automatically.
+		LOG(LOG_ERR, "Failed to find an available entry in our process table for pid %ld, aborting!", (long) pid);
+		notify("[KFMon] Can't spawn any more processes!");
+		exit(EXIT_FAILURE);
+	}
+
+	add_process_to_table((size_t) i, pid, watch_idx);
+	// NOTE: The child can't have been reaped yet (that only ever happens in our main loop),
+	//       so there's no pid recycling race to worry about here.
+	// NOTE: Our launcher's spawns aren't our children, we hear about their deaths from it (c.f., handle_launcher).
+	if (use_pidfd && !is_launched) {
+		PT.spawn_pidfds[i] = (int) syscall(SYS_pidfd_open, pid, 0);
+		if (PT.spawn_pidfds[i] == -1) {
+			perror("[KFMon] [ERR!] Aborting: pidfd_open");
+			notify("[KFMon] pidfd_open failed ?!");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	DBGLOG("Assigned pid %ld (from watch idx %zu) to process table entry idx %zd", (long) pid, watch_idx, i);
+	LOG(LOG_NOTICE,
+	    "Spawned process %ld (%s -> %s @ watch idx %zu) . . .",
+	    (long) pid,
+	    watch_config[watch_idx].filename,
+	    watch_config[watch_idx].action,
+	    watch_idx);
+	if (daemon_config.with_notifications) {
+		notify("[KFMon] Launched %s :)", basename(watch_config[watch_idx].action));
+	}
+
+	return pid;
+}
+
+// Launch a watch's action
+static pid_t
+    launch_watch(size_t watch_idx, uint64_t* spawn_us)
+{
+	LOG(LOG_INFO, "Preparing to spawn %s for watch idx %zu . . .", watch_config[watch_idx].action, watch_idx);
+	if (watch_config[watch_idx].block_spawns) {
+		LOG(LOG_NOTICE,
+		    "%s is flagged as a spawn blocker, it will prevent *any* event from triggering a spawn while it is still running!",
+		    watch_config[watch_idx].action);
+	}
+	// We're using execvp()...
+	char* const     cmd[] = { watch_config[watch_idx].action, NULL };
+	struct timespec ts;
+	update_watch_state(watch_idx, WATCH_EV_LAUNCH);
+	get_monotonic_time(&ts);
+	pid_t spid = spawn(cmd, watch_idx);
+	*spawn_us  = get_elapsed_us(&ts);
+	if (spid == -1) {
+		update_watch_state(watch_idx, WATCH_EV_EXEC_FAILED);
+	}
+
+	return spid;
+}
+
+// Check if a given inotify watch already has a spawn running
+static bool
+    is_watch_already_spawned(size_t watch_idx)
+{
+	return watch_config[watch_idx].spawn_pid != -1;
+}
+
+// Check if a watch flagged as a spawn blocker (f.g., KOReader or Plato) is already running
+// NOTE: This is mainly to prevent spurious spawns that might be unwittingly caused by their file manager
+//       (be it through metadata reading, thumbnails creation, or whatever).
+//       Another workaround is of course to kill KFMon as part of their startup process...
+static bool
+    is_blocker_running(void)
+{
+	return running_blockers > 0U;
+}
+
+// Return the pid of the spawn of a given inotify watch
+static pid_t
+    get_spawn_pid_for_watch(size_t watch_idx)
+{
+	return watch_config[watch_idx].spawn_pid;
+}
+
+static const char*
+    get_watch_state_name(WatchState state)
+{
+	switch (state) {
+		case WATCH_IDLE:
+			return "idle";
+		case WATCH_OPENED:
+			return "opened";
+		case WATCH_PENDING:
+			return "pending";
+		case WATCH_READY:
+			return "ready";
+		case WATCH_SPAWNED:
+			return "spawned";
+		case WATCH_RUNNING:
+			return "running";
+		default:
+			return "unknown";
+	}
+}
+
+static const char*
+    get_watch_event_name(WatchEvent event)
+{
+	switch (event) {
+		case WATCH_EV_OPEN_PROCESSED:
+			return "open (processed)";
+		case WATCH_EV_OPEN_UNPROCESSED:
+			return "open (unprocessed)";
+		case WATCH_EV_CLOSE_PROCESSED:
+			return "close (processed)";
+		case WATCH_EV_CLOSE_UNPROCESSED:
+			return "close (unprocessed)";
+		case WATCH_EV_LAUNCH:
+			return "launch";
+		case WATCH_EV_EXEC_OK:
+			return "exec ok";
+		case WATCH_EV_EXEC_FAILED:
+			return "exec failed";
+		case WATCH_EV_REAPED:
+			return "reaped";
+		case WATCH_EV_CANCEL:
+			return "cancel";
+		default:
+			return "unknown";
+	}
+}
+
+// The lifecycle of a watch: idle -> opened/pending -> ready -> spawned -> running -> idle.
+// Returns WATCH_STATE_COUNT if that event makes no sense in that state.
+// NOTE: This is a pure function of its arguments, so it can be exercised without inotify, Nickel, or anything else.
+//       Every check it depends on (is it processed? is its action or a spawn blocker running? is the DB busy?)
+//       is made by the caller, and folded into the event it feeds us (c.f., handle_watch_event).
+static WatchState
+    next_watch_state(WatchState state, WatchEvent event)
+{
+	switch (state) {
+		case WATCH_IDLE:
+		case WATCH_OPENED:
+		case WATCH_PENDING:
+			switch (event) {
+				case WATCH_EV_OPEN_PROCESSED:
+					return WATCH_OPENED;
+				case WATCH_EV_OPEN_UNPROCESSED:
+					return WATCH_PENDING;
+				case WATCH_EV_CLOSE_PROCESSED:
+					return WATCH_READY;
+				case WATCH_EV_CLOSE_UNPROCESSED:
+				case WATCH_EV_CANCEL:
+					return WATCH_IDLE;
+				case WATCH_EV_LAUNCH:
+					return WATCH_SPAWNED;
+				default:
+					return WATCH_STATE_COUNT;
+			}
+		case WATCH_READY:
+			// NOTE: Its launch is already on hold, so more events on its target don't change a thing.
+			switch (event) {
+				case WATCH_EV_OPEN_PROCESSED:
+				case WATCH_EV_OPEN_UNPROCESSED:
+				case WATCH_EV_CLOSE_PROCESSED:
+				case WATCH_EV_CLOSE_UNPROCESSED:
+					return WATCH_READY;
+				case WATCH_EV_LAUNCH:
+					return WATCH_SPAWNED;
+				case WATCH_EV_CANCEL:
+					return WATCH_IDLE;
+				default:
+					return WATCH_STATE_COUNT;
+			}
+		case WATCH_SPAWNED:
+			switch (event) {
+				case WATCH_EV_EXEC_OK:
+					return WATCH_RUNNING;
+				case WATCH_EV_EXEC_FAILED:
+					return WATCH_IDLE;
+				default:
+					return WATCH_STATE_COUNT;
+			}
+		case WATCH_RUNNING:
+			// NOTE: Nothing short of its death gets it out of there.
+			switch (event) {
+				case WATCH_EV_OPEN_PROCESSED:
+				case WATCH_EV_OPEN_UNPROCESSED:
+				case WATCH_EV_CLOSE_PROCESSED:
+				case WATCH_EV_CLOSE_UNPROCESSED:
+				case WATCH_EV_CANCEL:
+					return WATCH_RUNNING;
+				case WATCH_EV_REAPED:
+					return WATCH_IDLE;
+				default:
+					return WATCH_STATE_COUNT;
+			}
+		default:
+			return WATCH_STATE_COUNT;
+	}
+}
+
+// Feed an event to a watch's state machine, and log where that got it
+static void
+    update_watch_state(size_t watch_idx, WatchEvent event)
+{
+	WatchConfig* watch = &watch_config[watch_idx];
+	WatchState   state = next_watch_state(watch->state, event);
+
+	if (state == WATCH_STATE_COUNT) {
+		LOG(LOG_WARNING,
+		    "Watch idx %zu (%s): unexpected %s event while %s, ignoring it",
+		    watch_idx,
+		    watch->filename,
+		    get_watch_event_name(event),
+		    get_watch_state_name(watch->state));
+		return;
+	}
+	if (state != watch->state) {
+		LOG(LOG_INFO,
+		    "Watch idx %zu (%s): %s -> %s (%s)",
+		    watch_idx,
+		    watch->filename,
+		    get_watch_state_name(watch->state),
+		    get_watch_state_name(state),
+		    get_watch_event_name(event));
+		watch->state = state;
+	}
+}
+
+// Handle an IN_OPEN and/or IN_CLOSE event for a watch, returning what we decided to do about it
+// NOTE: Whether its target was still being processed by Nickel on IN_OPEN is tracked per watch (c.f., WATCH_PENDING),
+//       so that an icon Nickel is busy with can't prevent a tap on another one from launching anything.
+static JournalDecision
+    handle_watch_event(size_t watch_idx, uint32_t mask, uint64_t* check_us, uint64_t* spawn_us, pid_t* spid)
+{
+	WatchConfig*    watch    = &watch_config[watch_idx];
+	JournalDecision decision = JOURNAL_NONE;
+	struct timespec ts;
+
+	// Print event type
+	if (mask & IN_OPEN) {
+		LOG(LOG_NOTICE, "Tripped IN_OPEN for %s", watch->filename);
+		// Clunky detection of potential Nickel processing...
+		bool is_watch_spawned  = is_watch_already_spawned(watch_idx);
+		bool is_reader_spawned = is_blocker_running();
+
+		if (is_watch_spawned || is_reader_spawned) {
+			decision = is_watch_spawned ? JOURNAL_BUSY : JOURNAL_BLOCKED;
+		} else if (watch->state == WATCH_READY) {
+			// Its launch is already on hold, there's nothing left to check
+			decision = JOURNAL_DEFERRED;
+		} else {
+			// Only check if we're ready to spawn something...
+			get_monotonic_time(&ts);
+			bool is_processed = is_target_processed(watch_idx, false);
+			*check_us         = get_elapsed_us(&ts);
+			if (!is_processed) {
+				// It's not processed on OPEN, flag as pending...
+				update_watch_state(watch_idx, WATCH_EV_OPEN_UNPROCESSED);
+				decision = JOURNAL_PENDING;
+				LOG(LOG_INFO, "Flagged target icon '%s' as pending processing ...", watch->filename);
+			} else {
+				// It's already processed, we're good!
+				update_watch_state(watch_idx, WATCH_EV_OPEN_PROCESSED);
+			}
+		}
+	}
+	if (mask & IN_CLOSE) {
+		LOG(LOG_NOTICE, "Tripped IN_CLOSE for %s", watch->filename);
+		// NOTE: Make sure we won't run a specific command multiple times
+		//       while an earlier instance of it is still running...
+		//       This is mostly of interest for KOReader/Plato:
+		//       it means we can keep KFMon running while they're up,
+		//       without risking trying to spawn multiple instances of them,
+		//       in case they end up tripping their own inotify watch ;).
+		bool is_watch_spawned  = is_watch_already_spawned(watch_idx);
+		bool is_reader_spawned = is_blocker_running();
+
+		if (!is_watch_spawned && !is_reader_spawned && watch->state == WATCH_READY) {
+			// Its launch is already on hold (c.f., handle_db_wait)
+			decision = JOURNAL_DEFERRED;
+		} else if (!is_watch_spawned && !is_reader_spawned) {
+			// Check that our target file has already fully been processed by Nickel
+			// before launching anything...
+			bool is_processed = false;
+			if (watch->state != WATCH_PENDING) {
+				get_monotonic_time(&ts);
+				is_processed = is_target_processed(watch_idx, true);
+				*check_us    = get_elapsed_us(&ts);
+			}
+			update_watch_state(watch_idx,
+					   is_processed ? WATCH_EV_CLOSE_PROCESSED : WATCH_EV_CLOSE_UNPROCESSED);
+			if (is_processed && is_nickel_db_quiescent()) {
+				*spid    = launch_watch(watch_idx, spawn_us);
+				decision = *spid == -1 ? JOURNAL_FAILED : JOURNAL_SPAWNED;
+			} else if (is_processed) {
+				// Nickel is still busy writing to its DB, wait for it to settle down
+				// before launching anything (c.f., handle_db_wait).
+				defer_launch(watch_idx);
+				decision = JOURNAL_DEFERRED;
+			} else {
+				decision = JOURNAL_PENDING;
+				LOG(LOG_NOTICE,
+				    "Target icon '%s' might not have been fully processed by Nickel yet, don't launch anything.",
+				    watch->filename);
+				notify("[KFMon] Not spawning %s: still processing!", basename(watch->action));
+				// NOTE: That, or we hit a SQLITE_BUSY timeout on OPEN,
+				//       which tripped our 'pending processing' check.
+			}
 		} else {
-			LOG(LOG_NOTICE, "Successfully updated DB data for the target PNG");
-		}
+			if (is_watch_spawned) {
+				decision = JOURNAL_BUSY;
+				*spid    = get_spawn_pid_for_watch(watch_idx);
 
-		sqlite3_finalize(stmt);
+				LOG(LOG_INFO,
+				    "As watch idx %zu (%s) still has a spawned process (%ld -> %s) running, we won't be spawning another instance of it!",
+				    watch_idx,
+				    watch->filename,
+				    (long) *spid,
+				    watch->action);
+				notify("[KFMon] Not spawning %s: still running!", basename(watch->action));
+			} else if (is_reader_spawned) {
+				decision = JOURNAL_BLOCKED;
+				update_watch_state(watch_idx, WATCH_EV_CANCEL);
+				LOG(LOG_INFO,
+				    "As a spawn blocker process is currently running, we won't be spawning anything else to prevent unwanted behavior!");
+				notify("[KFMon] Not spawning %s: blocked!", basename(watch->action));
+			}
+		}
 	}
 
-	// A rather crappy check to wait for pending COMMITs...
-	if (is_processed && wait_for_db) {
-		// If there's a rollback journal for the DB, wait for it to go away...
-		// NOTE: This assumes the DB was opened with the default journal_mode, DELETE
-		//       This doesn't appear to be the case anymore, on FW >= 4.6.x (and possibly earlier),
-		//       it's now using WAL (which makes sense, and our whole job safer ;)).
-		const struct timespec zzz   = { 0L, 500000000L };
-		uint8_t               count = 0;
-		while (access(KOBO_DB_PATH "-journal", F_OK) == 0) {
-			LOG(LOG_INFO,
-			    "Found a SQLite rollback journal, waiting for it to go away (iteration nr. %hhu) . . .",
-			    (uint8_t) count++);
-			nanosleep(&zzz, NULL);
-			// NOTE: Don't wait more than 10s
-			if (count >= 20) {
-				LOG(LOG_WARNING,
-				    "Waited for the SQLite rollback journal to go away for far too long, going on anyway.");
-				break;
-			}
+	return decision;
+}
+
+
+// Coalesce a burst of IN_OPEN/IN_CLOSE events for a watch, so that we only go through a single check per burst.
+// NOTE: The first IN_OPEN of a burst is still handled right away, because it's what tells us whether Nickel
+//       has processed the icon *before* the burst (c.f., the 'pending processing' dance in handle_watch_event).
+//       Everything after that is put on hold until no new event came in for debounce_ms,
+//       at which point we only act on the final IN_CLOSE (c.f., handle_debounce_timer).
+static JournalDecision
+    debounce_event(size_t watch_idx, uint32_t mask, uint64_t* check_us, uint64_t* spawn_us, pid_t* spid)
+{
+	WatchConfig*    watch    = &watch_config[watch_idx];
+	JournalDecision decision = JOURNAL_COALESCED;
+
+	if (!watch->is_debouncing) {
+		watch->is_debouncing   = true;
+		watch->debounce_mask   = 0U;
+		watch->debounce_events = 0U;
+		watch->debounce_pos    = debouncing_count;
+		// NOTE: Our debounce timer only ever looks at the watches on that list
+		debouncing_watches[debouncing_count++] = watch_idx;
+		if (mask & IN_OPEN) {
+			decision = handle_watch_event(watch_idx, IN_OPEN, check_us, spawn_us, spid);
+			mask &= (uint32_t) ~IN_OPEN;
 		}
 	}
+	if (mask & (IN_OPEN | IN_CLOSE)) {
+		LOG(LOG_INFO,
+		    "Tripped %s for %s, waiting for things to settle down",
+		    (mask & IN_CLOSE) ? "IN_CLOSE" : "IN_OPEN",
+		    watch->filename);
+		watch->debounce_mask |= mask;
+		watch->debounce_events++;
+	}
 
-	sqlite3_close(db);
+	// (Re)start the clock
+	watch->debounce_event_ts = event_ts;
+	watch->debounce_deadline = event_ts;
+	watch->debounce_deadline.tv_sec += watch->debounce_ms / 1000U;
+	watch->debounce_deadline.tv_nsec += (long) (watch->debounce_ms % 1000U) * 1000000L;
+	if (watch->debounce_deadline.tv_nsec >= 1000000000L) {
+		watch->debounce_deadline.tv_sec++;
+		watch->debounce_deadline.tv_nsec -= 1000000000L;
+	}
+	arm_debounce_timer();
 
-	return is_processed;
+	return decision;
 }
 
-// Heavily inspired from https://stackoverflow.com/a/35235950
-// Initializes the process table. -1 means the entry in the table is available.
+// Take a watch off our list of watches in the middle of a burst (if it's on it)
 static void
-    init_process_table(void)
+    stop_debouncing(size_t watch_idx)
 {
-	for (uint8_t i = 0; i < WATCH_MAX; i++) {
-		PT.spawn_pids[i]     = -1;
-		PT.spawn_watchids[i] = -1;
+	WatchConfig* watch = &watch_config[watch_idx];
+	if (!watch->is_debouncing) {
+		return;
 	}
-}
+	watch->is_debouncing = false;
 
-// Returns the index of the next available entry in the process table.
-static int8_t
-    get_next_available_pt_entry(void)
-{
-	for (uint8_t i = 0; i < WATCH_MAX; i++) {
-		if (PT.spawn_watchids[i] == -1) {
-			return (int8_t) i;
-		}
+	// Order doesn't matter, so just move the last one in its place
+	size_t last_idx = debouncing_watches[--debouncing_count];
+	if (last_idx != watch_idx) {
+		debouncing_watches[watch->debounce_pos] = last_idx;
+		watch_config[last_idx].debounce_pos     = watch->debounce_pos;
 	}
-	return -1;
 }
 
-// Adds information about a new spawn to the process table.
+// Arm our debounce timer for the earliest pending deadline (or disarm it if there are none left)
 static void
-    add_process_to_table(uint8_t i, pid_t pid, uint8_t watch_idx)
+    arm_debounce_timer(void)
 {
-	PT.spawn_pids[i]     = pid;
-	PT.spawn_watchids[i] = (int8_t) watch_idx;
+	struct itimerspec deadline = { { 0L, 0L }, { 0L, 0L } };
+	for (size_t i = 0U; i < debouncing_count; i++) {
+		const WatchConfig* watch = &watch_config[debouncing_watches[i]];
+		if ((deadline.it_value.tv_sec == 0 && deadline.it_value.tv_nsec == 0L) ||
+		    watch->debounce_deadline.tv_sec < deadline.it_value.tv_sec ||
+		    (watch->debounce_deadline.tv_sec == deadline.it_value.tv_sec &&
+		     watch->debounce_deadline.tv_nsec < deadline.it_value.tv_nsec)) {
+			deadline.it_value = watch->debounce_deadline;
+		}
+	}
+	if (timerfd_settime(debounce_timer_fd, TFD_TIMER_ABSTIME, &deadline, NULL) == -1) {
+		perror("[KFMon] [WARN] timerfd_settime");
+	}
 }
 
-// Removes information about a spawn from the process table.
+// Our debounce timer expired, act on the bursts that have settled down
 static void
-    remove_process_from_table(uint8_t i)
+    handle_debounce_timer(void)
 {
-	PT.spawn_pids[i]     = -1;
-	PT.spawn_watchids[i] = -1;
+	uint64_t expirations;
+	if (read(debounce_timer_fd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN) {    // Flawfinder: ignore
+		perror("[KFMon] [WARN] read timerfd");
+	}
+
+	struct timespec now;
+	get_monotonic_time(&now);
+	// NOTE: Walk it backwards, as stop_debouncing moves the last one in place of the one we're done with.
+	for (size_t i = debouncing_count; i-- > 0U;) {
+		size_t       watch_idx = debouncing_watches[i];
+		WatchConfig* watch     = &watch_config[watch_idx];
+		if (watch->debounce_deadline.tv_sec > now.tv_sec ||
+		    (watch->debounce_deadline.tv_sec == now.tv_sec && watch->debounce_deadline.tv_nsec > now.tv_nsec)) {
+			continue;
+		}
+		stop_debouncing(watch_idx);
+
+		// Only the final IN_CLOSE warrants a check, everything else we've held back is a check saved
+		size_t saved = watch->debounce_events;
+		if (watch->debounce_mask & IN_CLOSE) {
+			saved--;
+		}
+		watch->coalesced_checks += saved;
+		if (saved > 0U) {
+			LOG(LOG_INFO,
+			    "Coalesced %zu events for %s, saving %zu checks",
+			    watch->debounce_events,
+			    watch->filename,
+			    saved);
+		}
+		if (watch->is_retired || !(watch->debounce_mask & IN_CLOSE)) {
+			continue;
+		}
+
+		// NOTE: Keep our event -> launch latency honest: it starts with the event that settled the burst
+		event_ts                 = watch->debounce_event_ts;
+		uint64_t        check_us = 0U;
+		uint64_t        spawn_us = 0U;
+		pid_t           spid     = -1;
+		JournalDecision decision = handle_watch_event(watch_idx, IN_CLOSE, &check_us, &spawn_us, &spid);
+		journal_event((ssize_t) watch_idx, IN_CLOSE, decision, check_us, spawn_us, spid);
+	}
+	arm_debounce_timer();
 }
 
-// Initializes the FBInk config
+// Forget about the bursts we were in the middle of (f.g., because our target mountpoint went away)
 static void
-    init_fbink_config(void)
+    cancel_debounced_events(void)
 {
-	// NOTE: The struct is zero-initialized, so we only tweak what's non-default
-	//       (the defaults are explictly designed to always be 0 for this very purpose).
-	fbink_config.row         = -5;
-	fbink_config.is_centered = true;
-	fbink_config.is_padded   = true;
-	// NOTE: For now, we *want* fbink_init's status report logged, so we leave this disabled.
-	// fbink_config.is_quiet = false;
+	while (debouncing_count > 0U) {
+		stop_debouncing(debouncing_watches[debouncing_count - 1U]);
+	}
+	arm_debounce_timer();
 }
 
-// Wait for a specific child process to die, and reap it (runs in a dedicated thread per spawn).
-void*
-    reaper_thread(void* ptr)
+// Make sure our inotify read buffer can hold at least len bytes
+static int
+    reserve_event_buffer(size_t len)
 {
-	uint8_t i = *((uint8_t*) ptr);
-
-	pid_t tid;
-	tid = (pid_t) syscall(SYS_gettid);
-
-	pid_t   cpid;
-	uint8_t watch_idx;
-	pthread_mutex_lock(&ptlock);
-	cpid      = PT.spawn_pids[i];
-	watch_idx = (uint8_t) PT.spawn_watchids[i];
-	pthread_mutex_unlock(&ptlock);
-
-	// Storage needed for get_current_time_r
-	struct tm local_tm;
-	char      sz_time[22];
-
-	// Remember the current time for the execvp errno/exitcode heuristic...
-	time_t then = time(NULL);
-
-	MTLOG("[%s] [INFO] [TID: %ld] Waiting to reap process %ld (from watch idx %hhu) . . .",
-	      get_current_time_r(&local_tm, sz_time, sizeof(sz_time)),
-	      (long) tid,
-	      (long) cpid,
-	      watch_idx);
-	pid_t ret;
-	int   wstatus;
-	// Wait for our child process to terminate, retrying on EINTR
-	do {
-		ret = waitpid(cpid, &wstatus, 0);
-	} while (ret == -1 && errno == EINTR);
-	// Recap what happened to it
-	if (ret != cpid) {
-		perror("[KFMon] [CRIT] waitpid");
-		free(ptr);
-		return (void*) NULL;
-	} else {
-		if (WIFEXITED(wstatus)) {
-			int exitcode = WEXITSTATUS(wstatus);
-			MTLOG(
-			    "[%s] [NOTE] [TID: %ld] Reaped process %ld (from watch idx %hhu): It exited with status %d.",
-			    get_current_time_r(&local_tm, sz_time, sizeof(sz_time)),
-			    (long) tid,
-			    (long) cpid,
-			    watch_idx,
-			    exitcode);
-			// NOTE: Ugly hack to try to salvage execvp's potential error...
-			//       If the process exited with a non-zero status code,
-			//       within (roughly) a second of being launched,
-			//       assume the exit code is actually inherited from execvp's errno...
-			time_t now = time(NULL);
-			// NOTE: We should be okay not using difftime on Linux (An Epoch is in UTC, time_t is int64_t).
-			if (exitcode != 0 && (now - then) <= 1) {
-				char buf[256];
-				// NOTE: We *know* we'll be using the GNU, glibc >= 2.13 version of strerror_r
-				// NOTE: Even if it's not entirely clear from the manpage, printf's %m *is* thread-safe,
-				//       c.f., stdio-common/vfprintf.c:962 (it's using strerror_r).
-				//       But since we're not checking errno but a custom variable, do it the hard way :)
-				char* sz_error = strerror_r(exitcode, buf, sizeof(buf));
-				MTLOG(
-				    "[%s] [CRIT] [TID: %ld] If nothing was visibly launched, and/or especially if status > 1, this *may* actually be an execvp() error: %s.",
-				    get_current_time_r(&local_tm, sz_time, sizeof(sz_time)),
-				    (long) tid,
-				    sz_error);
-				fbink_printf(FBFD_AUTO,
-					     NULL,
-					     &fbink_config,
-					     "[KFMon] PID %ld exited unexpectedly: %d!",
-					     (long) cpid,
-					     exitcode);
-			}
-		} else if (WIFSIGNALED(wstatus)) {
-			// NOTE: strsignal is not thread safe... Use psignal instead.
-			int  sigcode = WTERMSIG(wstatus);
-			char buf[256];
-			snprintf(
-			    buf,
-			    sizeof(buf),
-			    "[KFMon] [%s] [WARN] [TID: %ld] Reaped process %ld (from watch idx %hhu): It was killed by signal %d",
-			    get_current_time_r(&local_tm, sz_time, sizeof(sz_time)),
-			    (long) tid,
-			    (long) cpid,
-			    watch_idx,
-			    sigcode);
-			fbink_printf(FBFD_AUTO,
-				     NULL,
-				     &fbink_config,
-				     "[KFMon] PID %ld was killed by signal %d!",
-				     (long) cpid,
-				     sigcode);
-			if (daemon_config.use_syslog) {
-				// NOTE: No strsignal means no human-readable interpretation of the signal w/ syslog
-				//       (the %m token only works for errno)...
-				syslog(LOG_NOTICE, "%s", buf);
-			} else {
-				psignal(sigcode, buf);
-			}
-		}
+	// NOTE: Never go below a page, which also guarantees we can always fit at least one event, whatever its name.
+	len = MAX(len, 4096U);
+	if (len <= event_batch.buf_size) {
+		return 0;
 	}
 
-	// And now we can safely remove it from the process table
-	pthread_mutex_lock(&ptlock);
-	remove_process_from_table(i);
-	pthread_mutex_unlock(&ptlock);
-
-	free(ptr);
-
-	return (void*) NULL;
+	// NOTE: Some systems cannot read integer variables if they are not properly aligned.
+	//       On other systems, incorrect alignment may decrease performance.
+	//       Hence, the buffer used for reading from the inotify file descriptor
+	//       should have the same alignment as struct inotify_event, which malloc guarantees.
+	char* buf = realloc(event_batch.buf, len);
+	if (buf == NULL) {
+		perror("[KFMon] [ERR!] realloc");
+		return -1;
+	}
+	event_batch.buf      = buf;
+	event_batch.buf_size = len;
+	return 0;
 }
 
-// Spawn a process and return its pid...
-// Initially inspired from popen2() implementations from https://stackoverflow.com/questions/548063
-// As well as the glibc's system() call,
-// With a bit of added tracking to handle reaping without a SIGCHLD handler.
-static pid_t
-    spawn(char* const* command, uint8_t watch_idx)
+// Fold an event into what we've caught for that watch in the current batch
+static void
+    batch_watch_event(size_t watch_idx, uint32_t mask)
 {
-	pid_t pid;
-
-	pid = fork();
-
-	if (pid < 0) {
-		// Fork failed?
-		perror("[KFMon] [ERR!] Aborting: fork");
-		fbink_print(FBFD_AUTO, "[KFMon] fork failed ?!", &fbink_config);
-		exit(EXIT_FAILURE);
-	} else if (pid == 0) {
-		// Sweet child o' mine!
-		// NOTE: We're multithreaded & forking, this means that from this point on until execve(),
-		//       we can only use async-safe functions!
-		//       See pthread_atfork(3) for details.
-		// Do the whole stdin/stdout/stderr dance again,
-		// to ensure that child process doesn't inherit our tweaked fds...
-		dup2(orig_stdin, fileno(stdin));
-		dup2(orig_stdout, fileno(stdout));
-		dup2(orig_stderr, fileno(stderr));
-		close(orig_stdin);
-		close(orig_stdout);
-		close(orig_stderr);
-		// Restore signals
-		signal(SIGHUP, SIG_DFL);
-		// NOTE: We used to use execvpe when being launched from udev,
-		//       in order to sanitize all the crap we inherited from udev's env ;).
-		//       Now, we actually rely on the specific env we inherit from rcS/on-animator!
-		execvp(*command, command);
-		// NOTE: This will only ever be reached on error, hence the lack of actual return value check ;).
-		//       Resort to an ugly hack by exiting with execvp()'s errno,
-		//       which we can then try to salvage in the reaper thread.
-		exit(errno);
-	} else {
-		// Parent
-		// Keep track of the process
-		int8_t i;
-		pthread_mutex_lock(&ptlock);
-		i = get_next_available_pt_entry();
-		pthread_mutex_unlock(&ptlock);
-
-		if (i < 0) {
-			// NOTE: If we ever hit this error codepath,
-			//       we don't have to worry about leaving that last spawn as a zombie:
-			//       One of the benefits of the double-fork we do to daemonize is that, on our death,
-			//       our children will get reparented to init, which, by design,
-			//       will handle the reaping automatically.
-			LOG(LOG_ERR,
-			    "Failed to find an available entry in our process table for pid %ld, aborting!",
-			    (long) pid);
-			fbink_print(FBFD_AUTO, "[KFMon] Can't spawn any more processes!", &fbink_config);
-			exit(EXIT_FAILURE);
-		} else {
-			pthread_mutex_lock(&ptlock);
-			add_process_to_table((uint8_t) i, pid, watch_idx);
-			pthread_mutex_unlock(&ptlock);
-
-			DBGLOG("Assigned pid %ld (from watch idx %hhu) to process table entry idx %hhd",
-			       (long) pid,
-			       watch_idx,
-			       i);
-			// NOTE: We can't do that from the child proper, because it's not async-safe,
-			//       so do it from here.
-			LOG(LOG_NOTICE,
-			    "Spawned process %ld (%s -> %s @ watch idx %hhu) . . .",
-			    (long) pid,
-			    watch_config[watch_idx].filename,
-			    watch_config[watch_idx].action,
-			    watch_idx);
-			if (daemon_config.with_notifications) {
-				fbink_printf(FBFD_AUTO,
-					     NULL,
-					     &fbink_config,
-					     "[KFMon] Launched %s :)",
-					     basename(watch_config[watch_idx].action));
-			}
-			// NOTE: We achieve reaping in a non-blocking way by doing the reaping from a dedicated thread
-			//       for every spawn...
-			//       See #2 for an history of the previous failed attempts...
-			pthread_t rthread;
-			uint8_t*  arg = malloc(sizeof(*arg));
-			if (arg == NULL) {
-				LOG(LOG_ERR, "Couldn't allocate memory for thread arg, aborting!");
-				fbink_print(FBFD_AUTO, "[KFMon] OOM ?!", &fbink_config);
-				exit(EXIT_FAILURE);
-			}
-			*arg = (uint8_t) i;
-
-			// NOTE: We will *never* wait for one of these threads to die from the main thread, so,
-			//       start them in detached state
-			//       to make sure their resources will be released when they terminate.
-			pthread_attr_t attr;
-			if (pthread_attr_init(&attr) != 0) {
-				perror("[KFMon] [ERR!] Aborting: pthread_attr_init");
-				fbink_print(FBFD_AUTO, "[KFMon] pthread_attr_init failed ?!", &fbink_config);
-				exit(EXIT_FAILURE);
-			}
-			if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) != 0) {
-				perror("[KFMon] [ERR!] Aborting: pthread_attr_setdetachstate");
-				fbink_print(FBFD_AUTO, "[KFMon] pthread_attr_setdetachstate failed ?!", &fbink_config);
-				exit(EXIT_FAILURE);
-			}
-
-			// NOTE: Use a smaller stack (ulimit -s is 8MB on the Kobos).
-			//       Base it on pointer size, aiming for 1MB on x64 (meaning 512KB on x86/arm).
-			//       Floor it at 512KB to be safe, though.
-			//       In the grand scheme of things, this won't really change much ;).
-			if (pthread_attr_setstacksize(
-				&attr, MAX((1U * 1024U * 1024U) / 2U, (sizeof(void*) * 1024U * 1024U) / 8U)) != 0) {
-				perror("[KFMon] [ERR!] Aborting: pthread_attr_setstacksize");
-				fbink_print(FBFD_AUTO, "[KFMon] pthread_attr_setstacksize failed ?!", &fbink_config);
-				exit(EXIT_FAILURE);
-			}
-			if (pthread_create(&rthread, &attr, reaper_thread, arg) != 0) {
-				perror("[KFMon] [ERR!] Aborting: pthread_create");
-				fbink_print(FBFD_AUTO, "[KFMon] pthread_create failed ?!", &fbink_config);
-				exit(EXIT_FAILURE);
-			}
-
-			// Prettify the thread's name. Must be <= 15 characters long (i.e., 16 bytes, NULL included).
-			char thname[16];
-			snprintf(thname, sizeof(thname), "Reaper:%ld", (long) pid);
-			if (pthread_setname_np(rthread, thname) != 0) {
-				perror("[KFMon] [ERR!] Aborting: pthread_setname_np");
-				fbink_print(FBFD_AUTO, "[KFMon] pthread_setname_np failed ?!", &fbink_config);
-				exit(EXIT_FAILURE);
-			}
-
-			if (pthread_attr_destroy(&attr) != 0) {
-				perror("[KFMon] [ERR!] Aborting: pthread_attr_destroy");
-				fbink_print(FBFD_AUTO, "[KFMon] pthread_attr_destroy failed ?!", &fbink_config);
+	WatchConfig* watch = &watch_config[watch_idx];
+
+	if (watch->batch_mask == 0U) {
+		// First time we hear about it in this batch, remember it, in order
+		if (event_batch.watch_count >= event_batch.watch_capacity) {
+			size_t  new_capacity = event_batch.watch_capacity ? event_batch.watch_capacity * 2U : 16U;
+			size_t* new_watches  = realloc(event_batch.watches, new_capacity * sizeof(*new_watches));
+			if (new_watches == NULL) {
+				perror("[KFMon] [ERR!] Aborting: realloc");
+				notify("[KFMon] OOM ?!");
 				exit(EXIT_FAILURE);
 			}
+			event_batch.watches        = new_watches;
+			event_batch.watch_capacity = new_capacity;
 		}
+		event_batch.watches[event_batch.watch_count++] = watch_idx;
+		watch->batch_events                             = 0U;
+		watch->is_batch_reopened                        = false;
 	}
 
-	return pid;
-}
-
-// Check if a given inotify watch already has a spawn running
-static bool
-    is_watch_already_spawned(uint8_t watch_idx)
-{
-	// Walk our process table to see if the given watch currently has a registered running process
-	for (uint8_t i = 0; i < WATCH_MAX; i++) {
-		if (PT.spawn_watchids[i] == (int8_t) watch_idx) {
-			return true;
-			// NOTE: Assume everything's peachy,
-			//       and we'll never end up with the same watch_idx assigned to multiple indices in the
-			//       process table.
+	// NOTE: Any number of OPEN/CLOSE pairs fold into a single one (plus a trailing OPEN, if it was opened again
+	//       after the final CLOSE), which is all our decisions ever depend on (c.f., handle_watch_event).
+	if (mask & IN_OPEN) {
+		if (watch->batch_mask & IN_CLOSE) {
+			watch->is_batch_reopened = true;
+		} else {
+			watch->batch_mask |= IN_OPEN;
 		}
+		watch->batch_events++;
 	}
-
-	return false;
+	if (mask & IN_CLOSE) {
+		if (watch->is_batch_reopened) {
+			watch->batch_mask |= IN_OPEN;
+			watch->is_batch_reopened = false;
+		}
+		watch->batch_mask |= IN_CLOSE;
+		watch->batch_events++;
+	}
+	watch->batch_mask |= mask & (IN_UNMOUNT | IN_IGNORED);
 }
 
-// Check if a watch flagged as a spawn blocker (f.g., KOReader or Plato) is already running
-// NOTE: This is mainly to prevent spurious spawns that might be unwittingly caused by their file manager
-//       (be it through metadata reading, thumbnails creation, or whatever).
-//       Another workaround is of course to kill KFMon as part of their startup process...
-static bool
-    is_blocker_running(void)
+// Act on what we've caught for a watch in the current batch, once
+static void
+    handle_batched_watch(size_t watch_idx)
 {
-	// Walk our process table to identify watches with a currently running process
-	for (uint8_t i = 0; i < WATCH_MAX; i++) {
-		if (PT.spawn_watchids[i] != -1) {
-			// Walk the registered watch list to match that currently running watch to its block_spawns flag
-			for (uint8_t watch_idx = 0; watch_idx < watch_count; watch_idx++) {
-				if (PT.spawn_watchids[i] == (int8_t) watch_idx) {
-					if (watch_config[watch_idx].block_spawns) {
-						return true;
-					}
-				}
-			}
-		}
+	WatchConfig* watch = &watch_config[watch_idx];
+	uint32_t     mask  = watch->batch_mask & (IN_OPEN | IN_CLOSE);
+
+	// Everything we've folded away is a check saved
+	size_t handled = (size_t) !!(mask & IN_OPEN) + (size_t) !!(mask & IN_CLOSE) + (size_t) watch->is_batch_reopened;
+	if (watch->batch_events > handled) {
+		LOG(LOG_INFO,
+		    "Folded %zu events for %s into %zu, saving %zu checks",
+		    watch->batch_events,
+		    watch->filename,
+		    handled,
+		    watch->batch_events - handled);
+		watch->coalesced_checks += watch->batch_events - handled;
+	}
+	if (watch->is_retired) {
+		return;
 	}
 
-	// Nothing currently running is a spawn blocker, we're good to go!
-	return false;
+	// Keep track of what we do about it, for our journal
+	JournalDecision decision = JOURNAL_NONE;
+	uint64_t        check_us = 0U;
+	uint64_t        spawn_us = 0U;
+	pid_t           spid     = -1;
+
+	if (mask && watch->debounce_ms > 0U) {
+		// Nickel tends to open & close the same icon quite a few times in a row
+		// while processing it, so, fold those into a single check (c.f., debounce_event).
+		decision = debounce_event(watch_idx, mask, &check_us, &spawn_us, &spid);
+	} else if (mask) {
+		decision = handle_watch_event(watch_idx, mask, &check_us, &spawn_us, &spid);
+	}
+	journal_event((ssize_t) watch_idx, watch->batch_mask, decision, check_us, spawn_us, spid);
+
+	if (watch->is_batch_reopened) {
+		check_us = 0U;
+		spawn_us = 0U;
+		spid     = -1;
+		if (watch->debounce_ms > 0U) {
+			decision = debounce_event(watch_idx, IN_OPEN, &check_us, &spawn_us, &spid);
+		} else {
+			decision = handle_watch_event(watch_idx, IN_OPEN, &check_us, &spawn_us, &spid);
+		}
+		journal_event((ssize_t) watch_idx, IN_OPEN, decision, check_us, spawn_us, spid);
+	}
 }
 
-// Return the pid of the spawn of a given inotify watch
-static pid_t
-    get_spawn_pid_for_watch(uint8_t watch_idx)
+// A watch was destroyed by the kernel (its target was deleted or replaced, or its mountpoint went away)
+static void
+    handle_destroyed_watch(int fd, size_t watch_idx)
 {
-	for (uint8_t i = 0; i < WATCH_MAX; i++) {
-		if (PT.spawn_watchids[i] == (int8_t) watch_idx) {
-			return PT.spawn_pids[i];
-		}
+	LOG(LOG_NOTICE, "Tripped IN_IGNORED for %s", watch_config[watch_idx].filename);
+	// The kernel has already let go of it
+	set_watch_wd(watch_idx, -1);
+	reset_thumbnail_state(watch_idx);
+	// NOTE: Something (badly coalesced/ordered events?) is a bit wonky on the Kobos
+	//       when onboard gets unmounted:
+	//       we actually never get an IN_UNMOUNT event, only IN_IGNORED...
+	//       Another strange behavior is that we get them in a staggered mannered,
+	//       and not in one batch, as I do on my sandbox when unmounting a tmpfs...
+	//       Which is why we don't rely on IN_UNMOUNT,
+	//       and check the mount table on the first IN_IGNORED instead.
+	//       In the end, we behave properly, but it's still strange enough to document ;).
+	// If that's because our target mountpoint went away, let go of everything.
+	// Otherwise, it was deleted or replaced, so only this one watch needs attention:
+	// try to re-arm it right away, in case it's already back,
+	// otherwise, we'll catch it coming back (c.f., handle_parent_event).
+	handle_mount_change(fd);
+	if (watches_mount_id != -1 && watch_config[watch_idx].inotify_wd == -1 && !watch_config[watch_idx].is_retired) {
+		arm_watch(fd, watch_idx);
 	}
-
-	return -1;
 }
 
 // Read all available inotify events from the file descriptor 'fd'.
-static bool
+// NOTE: We drain the queue first, folding the events for our target files into what we need to know about each of them,
+//       and only then do we act on it, once per watch. That keeps event storms (f.g., Nickel rescanning its library)
+//       down to a single read, and a single check per watch.
+static void
     handle_events(int fd)
 {
-	// Some systems cannot read integer variables if they are not properly aligned.
-	// On other systems, incorrect alignment may decrease performance.
-	// Hence, the buffer used for reading from the inotify file descriptor
-	// should have the same alignment as struct inotify_event.
-	char                        buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
 	const struct inotify_event* event;
-	bool                        destroyed_wd       = false;
-	bool                        was_unmounted      = false;
-	static bool                 pending_processing = false;
+	bool                        was_unmounted     = false;
+	bool                        was_overflowed    = false;
+	bool                        is_db_wait_change = false;
 
 	// Loop while events can be read from inotify file descriptor.
 	for (;;) {
+		// Size our buffer after what's actually pending, so we can usually slurp it all in one go
+		int avail = 0;
+		if (ioctl(fd, FIONREAD, &avail) == -1) {
+			perror("[KFMon] [WARN] ioctl FIONREAD");
+			avail = 0;
+		}
+		if (reserve_event_buffer((size_t) MAX(avail, 0)) != 0) {
+			notify("[KFMon] OOM ?!");
+			exit(EXIT_FAILURE);
+		}
+
 		// Read some events.
-		ssize_t len = read(fd, buf, sizeof(buf));    // Flawfinder: ignore
+		ssize_t len = read(fd, event_batch.buf, event_batch.buf_size);    // Flawfinder: ignore
+		get_monotonic_time(&event_ts);
 		if (len == -1 && errno != EAGAIN) {
 			perror("[KFMon] [ERR!] Aborting: read");
-			fbink_print(FBFD_AUTO, "[KFMon] read failed ?!", &fbink_config);
+			notify("[KFMon] read failed ?!");
 			exit(EXIT_FAILURE);
 		}
 
@@ -1333,7 +5606,8 @@ static bool
 		}
 
 		// Loop over all events in the buffer
-		for (char* ptr = buf; ptr < buf + len; ptr += sizeof(struct inotify_event) + event->len) {
+		for (char* ptr = event_batch.buf; ptr < event_batch.buf + len;
+		     ptr += sizeof(struct inotify_event) + event->len) {
 			// NOTE: This trips -Wcast-align on ARM, but should be safe nonetheless ;).
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wcast-align"
@@ -1342,242 +5616,109 @@ static bool
 			// NOTE: This *may* be a viable alternative, but don't hold me to that.
 			// memcpy(&event, &ptr, sizeof(struct inotify_event *));
 
-			// Identify which of our target file we've caught an event for...
-			uint8_t watch_idx       = 0;
-			bool    found_watch_idx = false;
-			for (watch_idx = 0; watch_idx < watch_count; watch_idx++) {
-				if (watch_config[watch_idx].inotify_wd == event->wd) {
-					found_watch_idx = true;
-					break;
-				}
+			// We've lost some events, we'll make sure we're still watching the right things once we're done.
+			if (event->mask & IN_Q_OVERFLOW) {
+				LOG(LOG_WARNING, "Huh oh... Tripped IN_Q_OVERFLOW, some events were lost!");
+				was_overflowed = true;
+				journal_event(-1, event->mask, JOURNAL_NONE, 0U, 0U, -1);
+				continue;
 			}
-			if (!found_watch_idx) {
-				// NOTE: Err, that should (hopefully) never happen!
-				LOG(LOG_CRIT,
-				    "!! Failed to match the current inotify event to any of our watched file! !!");
-			}
-
-			// NOTE: Now that, hopefully, we're pretty sure Nickel is up or on its way up,
-			//       and has finished or will soon finish setting up the fb,
-			//       we can reinit FBInk to have up to date information...
-			//       Put everything behind our mutex to be super-safe,
-			//       since we're playing with library globals...
-			//       We do this the least amount of times possible,
-			//       (i.e., once, if every watch has already been processed),
-			//       to keep locking to a minimum.
-			// NOTE: But, we may do it more than once, in fact, we'll re-init on each new event
-			//       until we get a framebuffer state that is no longer quirky
-			//       (i.e., once we're sure we got it from Nickel, and not pickel).
-			//       This is needed because processing is done very early by Nickel for "new" icons when
-			//       they end up on the Home screen straight away,
-			//       (which is a given if you added at most 3 items, with the new Home screen).
-			//       It's problematic for us, because it's early enough that pickel is still running,
-			//       so we inherit its quirky fb setup and not Nickel's...
-			pthread_mutex_lock(&ptlock);
-			// NOTE: It went fine once, assume that'll still be the case and skip error checking...
-			fbink_reinit(FBFD_AUTO, &fbink_config);
-			pthread_mutex_unlock(&ptlock);
-
-			// Print event type
-			if (event->mask & IN_OPEN) {
-				LOG(LOG_NOTICE, "Tripped IN_OPEN for %s", watch_config[watch_idx].filename);
-				// Clunky detection of potential Nickel processing...
-				bool is_watch_spawned;
-				bool is_reader_spawned;
-				pthread_mutex_lock(&ptlock);
-				is_watch_spawned  = is_watch_already_spawned(watch_idx);
-				is_reader_spawned = is_blocker_running();
-				pthread_mutex_unlock(&ptlock);
-
-				if (!is_watch_spawned && !is_reader_spawned) {
-					// Only check if we're ready to spawn something...
-					if (!is_target_processed(watch_idx, false)) {
-						// It's not processed on OPEN, flag as pending...
-						pending_processing = true;
-						LOG(LOG_INFO,
-						    "Flagged target icon '%s' as pending processing ...",
-						    watch_config[watch_idx].filename);
-					} else {
-						// It's already processed, we're good!
-						pending_processing = false;
-					}
+
+			// Identify which of our target file we've caught an event for, as that's what most of them are...
+			ssize_t found_idx = find_watch_by_wd(event->wd);
+			if (found_idx != -1) {
+				if (event->mask & IN_UNMOUNT) {
+					LOG(LOG_NOTICE, "Tripped IN_UNMOUNT for %s", watch_config[found_idx].filename);
+					// Remember that we encountered an unmount,
+					// so we can explain where our watches went...
+					was_unmounted = true;
 				}
+				batch_watch_event((size_t) found_idx, event->mask);
+				continue;
 			}
-			if (event->mask & IN_CLOSE) {
-				LOG(LOG_NOTICE, "Tripped IN_CLOSE for %s", watch_config[watch_idx].filename);
-				// NOTE: Make sure we won't run a specific command multiple times
-				//       while an earlier instance of it is still running...
-				//       This is mostly of interest for KOReader/Plato:
-				//       it means we can keep KFMon running while they're up,
-				//       without risking trying to spawn multiple instances of them,
-				//       in case they end up tripping their own inotify watch ;).
-				bool is_watch_spawned;
-				bool is_reader_spawned;
-				pthread_mutex_lock(&ptlock);
-				is_watch_spawned  = is_watch_already_spawned(watch_idx);
-				is_reader_spawned = is_blocker_running();
-				pthread_mutex_unlock(&ptlock);
-
-				if (!is_watch_spawned && !is_reader_spawned) {
-					// Check that our target file has already fully been processed by Nickel
-					// before launching anything...
-					if (!pending_processing && is_target_processed(watch_idx, true)) {
-						LOG(LOG_INFO,
-						    "Preparing to spawn %s for watch idx %hhu . . .",
-						    watch_config[watch_idx].action,
-						    watch_idx);
-						if (watch_config[watch_idx].block_spawns) {
-							LOG(LOG_NOTICE,
-							    "%s is flagged as a spawn blocker, it will prevent *any* event from triggering a spawn while it is still running!",
-							    watch_config[watch_idx].action);
-						}
-						// We're using execvp()...
-						char* const cmd[] = { watch_config[watch_idx].action, NULL };
-						spawn(cmd, watch_idx);
-					} else {
-						LOG(LOG_NOTICE,
-						    "Target icon '%s' might not have been fully processed by Nickel yet, don't launch anything.",
-						    watch_config[watch_idx].filename);
-						fbink_printf(FBFD_AUTO,
-							     NULL,
-							     &fbink_config,
-							     "[KFMon] Not spawning %s: still processing!",
-							     basename(watch_config[watch_idx].action));
-						// NOTE: That, or we hit a SQLITE_BUSY timeout on OPEN,
-						//       which tripped our 'pending processing' check.
-					}
-				} else {
-					if (is_watch_spawned) {
-						pid_t spid;
-						pthread_mutex_lock(&ptlock);
-						spid = get_spawn_pid_for_watch(watch_idx);
-						pthread_mutex_unlock(&ptlock);
-
-						LOG(LOG_INFO,
-						    "As watch idx %hhu (%s) still has a spawned process (%ld -> %s) running, we won't be spawning another instance of it!",
-						    watch_idx,
-						    watch_config[watch_idx].filename,
-						    (long) spid,
-						    watch_config[watch_idx].action);
-						fbink_printf(FBFD_AUTO,
-							     NULL,
-							     &fbink_config,
-							     "[KFMon] Not spawning %s: still running!",
-							     basename(watch_config[watch_idx].action));
-					} else if (is_reader_spawned) {
-						LOG(LOG_INFO,
-						    "As a spawn blocker process is currently running, we won't be spawning anything else to prevent unwanted behavior!");
-						fbink_printf(FBFD_AUTO,
-							     NULL,
-							     &fbink_config,
-							     "[KFMon] Not spawning %s: blocked!",
-							     basename(watch_config[watch_idx].action));
-					}
+
+			// Otherwise, one of our target files may have just (re)appeared (c.f., arm_parent_watch)
+			bool is_parent_event = handle_parent_event(fd, event);
+
+			// Something changed in our config directory, reload what needs to be...
+			if (config_wd != -1 && event->wd == config_wd) {
+				if (event->mask & IN_IGNORED) {
+					// NOTE: If that's because of an unmount, it'll be setup again on remount.
+					LOG(LOG_NOTICE,
+					    "Lost our inotify watch on config directory '%s'",
+					    KFMON_CONFIGPATH);
+					config_wd = -1;
+				} else if (event->len && !(event->mask & IN_CREATE) && is_config_filename(event->name)) {
+					// NOTE: We only get IN_CREATE if one of our targets lives in there,
+					//       and we'll get an IN_CLOSE_WRITE once there's something in that new file.
+					reload_config_file(fd, event->name);
+					refresh_config_file(event->name);
 				}
+				continue;
 			}
-			if (event->mask & IN_UNMOUNT) {
-				LOG(LOG_NOTICE, "Tripped IN_UNMOUNT for %s", watch_config[watch_idx].filename);
-				// Remember that we encountered an unmount,
-				// so we don't try to manually remove watches that are already gone...
-				was_unmounted = true;
-			}
-			// NOTE: Something (badly coalesced/ordered events?) is a bit wonky on the Kobos
-			//       when onboard gets unmounted:
-			//       we actually never get an IN_UNMOUNT event, only IN_IGNORED...
-			//       Another strange behavior is that we get them in a staggered mannered,
-			//       and not in one batch, as I do on my sandbox when unmounting a tmpfs...
-			//       That may explain why the explicit inotify_rm_watch() calls we do later
-			//       on all our other watches don't seem to error out...
-			//       In the end, we behave properly, but it's still strange enough to document ;).
-			if (event->mask & IN_IGNORED) {
-				LOG(LOG_NOTICE, "Tripped IN_IGNORED for %s", watch_config[watch_idx].filename);
-				// Remember that the watch was automatically destroyed so we can break from the loop...
-				destroyed_wd                             = true;
-				watch_config[watch_idx].wd_was_destroyed = true;
+			if (is_parent_event) {
+				continue;
 			}
-			if (event->mask & IN_Q_OVERFLOW) {
-				if (event->len) {
-					LOG(LOG_WARNING, "Huh oh... Tripped IN_Q_OVERFLOW for %s", event->name);
-				} else {
-					LOG(LOG_WARNING, "Huh oh... Tripped IN_Q_OVERFLOW for... something?");
-				}
-				// Try to remove the inotify watch we matched
-				// (... hoping matching actually was successful), and break the loop.
-				LOG(LOG_INFO,
-				    "Trying to remove inotify watch for '%s' @ index %hhu.",
-				    watch_config[watch_idx].filename,
-				    watch_idx);
-				if (inotify_rm_watch(fd, watch_config[watch_idx].inotify_wd) == -1) {
-					// That's too bad, but may not be fatal, so warn only...
-					perror("[KFMon] [WARN] inotify_rm_watch");
-				} else {
-					// Flag it as gone if rm was successful
-					watch_config[watch_idx].inotify_wd = -1;
-				}
-				destroyed_wd                             = true;
-				watch_config[watch_idx].wd_was_destroyed = true;
-			}
-		}
-
-		// If we caught an unmount, explain why we don't explictly have to tear down our watches
-		if (was_unmounted) {
-			LOG(LOG_INFO, "Unmount detected, nothing to do, all watches will naturally get destroyed.");
-		}
-		// If we caught an event indicating that a watch was automatically destroyed, break the loop.
-		if (destroyed_wd) {
-			// But before we do that, make sure we've removed *all* our *other* watches first
-			// (again, hoping matching was successful), since we'll be setting them up all again later...
-			for (uint8_t watch_idx = 0; watch_idx < watch_count; watch_idx++) {
-				if (!watch_config[watch_idx].wd_was_destroyed) {
-					// Don't do anything if that was because of an unmount...
-					// Because that assures us that everything is/will soon be gone
-					// (since by design, all our target files live on the same mountpoint),
-					// even if we didn't get to parse all the events in one go
-					// to flag them as destroyed one by one.
-					if (!was_unmounted) {
-						// Check if that watch index is active to begin with,
-						// as we might have just skipped it if its target file was missing...
-						if (watch_config[watch_idx].inotify_wd == -1) {
-							LOG(LOG_INFO,
-							    "Inotify watch for '%s' @ index %hhu is already inactive!",
-							    watch_config[watch_idx].filename,
-							    watch_idx);
-						} else {
-							// Log what we're doing...
-							LOG(LOG_INFO,
-							    "Trying to remove inotify watch for '%s' @ index %hhu.",
-							    watch_config[watch_idx].filename,
-							    watch_idx);
-							if (inotify_rm_watch(fd, watch_config[watch_idx].inotify_wd) ==
-							    -1) {
-								// That's too bad, but may not be fatal, so warn only...
-								perror("[KFMon] [WARN] inotify_rm_watch");
-							} else {
-								// It's gone!
-								watch_config[watch_idx].inotify_wd = -1;
-							}
-						}
-					}
+
+			// Something happened to Nickel's DB, see if we were waiting on that (c.f., defer_launch)
+			if (db_wait.wd != -1 && event->wd == db_wait.wd) {
+				if (event->mask & IN_IGNORED) {
+					db_wait.wd = -1;
 				} else {
-					// Reset the flag to avoid false-positives on the next iteration of the loop,
-					// since we re-use the array's content.
-					watch_config[watch_idx].wd_was_destroyed = false;
+					is_db_wait_change = true;
 				}
+				continue;
 			}
-			break;
+
+			if (handle_thumbnail_event(event)) {
+				// One of the thumbnail directories we're keeping an eye on (c.f., probe_thumbnails)
+				continue;
+			}
+			if (event->mask & (IN_IGNORED | IN_UNMOUNT)) {
+				// That's the tail end of a watch we removed ourselves (c.f., retire_watch, disarm_watches)
+				continue;
+			}
+			// NOTE: Err, that should (hopefully) never happen!
+			LOG(LOG_CRIT, "!! Failed to match the current inotify event to any of our watched file! !!");
+		}
+	}
+
+	// If we caught an unmount, explain why we won't re-arm our watches right away
+	if (was_unmounted) {
+		LOG(LOG_INFO, "Unmount detected, all watches will naturally get destroyed.");
+	}
+
+	// Now that we know everything there is to know, act on it, once per watch
+	for (size_t i = 0U; i < event_batch.watch_count; i++) {
+		handle_batched_watch(event_batch.watches[i]);
+	}
+	// Then see to the watches that were destroyed (which may very well tear everything down, hence the separate pass)
+	for (size_t i = 0U; i < event_batch.watch_count; i++) {
+		size_t watch_idx = event_batch.watches[i];
+		if (watch_config[watch_idx].batch_mask & IN_IGNORED) {
+			handle_destroyed_watch(fd, watch_idx);
 		}
+		watch_config[watch_idx].batch_mask = 0U;
 	}
+	event_batch.watch_count = 0U;
 
-	// And we have another outer loop to break, so pass that on...
-	return destroyed_wd;
+	// Nickel's DB may have settled down, see if we can go ahead with a deferred launch
+	if (is_db_wait_change) {
+		handle_db_wait(false);
+	}
+	if (was_overflowed) {
+		resync_watches(fd);
+	}
 }
 
 int
     main(int argc __attribute__((unused)), char* argv[] __attribute__((unused)))
 {
-	int           fd;
-	int           poll_num;
-	struct pollfd pfd;
+	int            fd;
+	int            poll_num;
+	struct pollfd* pfds;
+	size_t*        pfd_pt_entries;
+	size_t         pfds_pt_size;
 
 	// Make sure we're running at a neutral niceness
 	// (f.g., being launched via udev would leave us with a negative nice value).
@@ -1592,6 +5733,9 @@ int
 		exit(EXIT_FAILURE);
 	}
 
+	// We only need to do this once, localtime_r doesn't care about TZ changes anyway.
+	tzset();
+
 	// Say hello :)
 	LOG(LOG_INFO,
 	    "[PID: %ld] Initializing KFMon %s | Built on %s @ %s | Using SQLite %s (built against version %s) | With FBInk %s",
@@ -1603,6 +5747,12 @@ int
 	    SQLITE_VERSION,
 	    fbink_version());
 
+	// Keep an eye on the mount table, our configs (and our targets) live on the target mountpoint
+	if (open_mount_state() != 0) {
+		LOG(LOG_ERR, "Failed to open the mount table, aborting!");
+		exit(EXIT_FAILURE);
+	}
+
 	// Load our configs
 	if (load_config() == -1) {
 		LOG(LOG_ERR, "Failed to load one or more config files, aborting!");
@@ -1627,8 +5777,72 @@ int
 		openlog("kfmon", LOG_CONS | LOG_PID | LOG_NDELAY, LOG_DAEMON);
 	}
 
+	// Fork our launcher *now*, while we're still small, and single-threaded (c.f., start_launcher)
+	if (daemon_config.use_launcher) {
+		if (start_launcher() == 0) {
+			atexit(stop_launcher);
+		} else {
+			LOG(LOG_WARNING, "Failed to start our launcher, we'll launch things ourselves");
+		}
+	}
+
+	if (!daemon_config.use_syslog) {
+		// Take logging off the event path
+		if (start_logger() == 0) {
+			// NOTE: Registered first so that it runs last, after anything that may still want to log on exit.
+			atexit(stop_logger);
+		} else {
+			LOG(LOG_WARNING, "Failed to start the async logger, logging synchronously");
+		}
+	}
+
 	// Initialize the process table, to track our spawns
-	init_process_table();
+	if (init_process_table() != 0) {
+		LOG(LOG_ERR, "Failed to initialize the process table, aborting!");
+		exit(EXIT_FAILURE);
+	}
+	// Setup signal handling & reaping *before* we ever get a chance to spawn anything
+	if (init_signals() != 0) {
+		LOG(LOG_ERR, "Failed to setup signal handling, aborting!");
+		exit(EXIT_FAILURE);
+	}
+	// Dump our latency stats on our way out
+	atexit(dump_latency_histograms);
+	// Map our event journal, if requested
+	if (daemon_config.use_journal) {
+		if (open_journal() == 0) {
+			atexit(close_journal);
+		} else {
+			LOG(LOG_WARNING, "Failed to setup the event journal, going on without it");
+		}
+	}
+	// Let scripts talk to us (c.f., control.h)
+	if (open_control_socket() == 0) {
+		atexit(close_control_socket);
+	} else {
+		LOG(LOG_WARNING, "Failed to setup the control socket, going on without it");
+	}
+	// The tick we use to keep an eye on Nickel's DB while a launch is on hold (c.f., defer_launch),
+	// and the one we use to tell when a burst of events has settled down (c.f., debounce_event).
+	db_wait.timer_fd  = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	debounce_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (db_wait.timer_fd == -1 || debounce_timer_fd == -1) {
+		perror("[KFMon] [ERR!] Aborting: timerfd_create");
+		exit(EXIT_FAILURE);
+	}
+	// Our poll set: inotify, mounts, signals, DB wait tick, debounce timer, control socket, launcher,
+	// and then (potentially) a pidfd per spawn.
+	// NOTE: Like the process table, it's sized after our watch registry, so it only needs to grow on config reloads.
+	pfds           = calloc(PFD_COUNT + PT.size, sizeof(*pfds));
+	pfd_pt_entries = calloc(PT.size, sizeof(*pfd_pt_entries));
+	if (pfds == NULL || pfd_pt_entries == NULL) {
+		perror("[KFMon] [ERR!] Aborting: calloc");
+		exit(EXIT_FAILURE);
+	}
+	pfds_pt_size = PT.size;
+
+	// Remember which of our targets we've already seen fully processed by Nickel
+	load_processed_cache();
 
 	// Initialize FBInk
 	init_fbink_config();
@@ -1638,6 +5852,13 @@ int
 		LOG(LOG_ERR, "Failed to initialize FBInk, aborting!");
 		exit(EXIT_FAILURE);
 	}
+	init_fb_state();
+	// From now on, only our notifier thread touches FBInk
+	if (start_notifier() != 0) {
+		LOG(LOG_ERR, "Failed to start the notifier thread, aborting!");
+		exit(EXIT_FAILURE);
+	}
+	atexit(stop_notifier);
 
 	// NOTE: Because of course we can't have nice things, at this point,
 	//       Nickel hasn't finished setting up the fb to its liking. To be fair, it hasn't even started yet ;).
@@ -1652,108 +5873,140 @@ int
 	//       while completely broken info would only cause the MXCFB ioctl to fail, we wouldn't segfault.
 	//       (Well, to be perfectly fair, it'd take an utterly broken finfo.smem_len to crash,
 	//       and that should never happen).
-	// NOTE: To get up to date info, we'll reinit on each new inotify event we catch,
-	//       until we get something we can keep (i.e., Nickel's fb setup),
-	//       at which point we'll stop doing those extra init calls,
-	//       because we assume no-one will mess with it again (and no-one should).
+	// NOTE: To get up to date info, we'll check the fb setup before each notification we show,
+	//       and reinit whenever it's changed (i.e., once Nickel's fb setup kicks in, and on rotation).
+	//       Since that's just an ioctl on an fd we keep around, once things have settled down,
+	//       we never do those extra init calls again.
 	if (daemon_config.with_notifications) {
-		fbink_print(FBFD_AUTO, "[KFMon] Successfully initialized. :)", &fbink_config);
+		notify("[KFMon] Successfully initialized. :)");
+	}
+
+	// Create the file descriptor for accessing the inotify API
+	// NOTE: It lives for as long as we do, only our watches come & go with the target mountpoint (c.f., arm_watches).
+	LOG(LOG_INFO, "Initializing inotify.");
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd == -1) {
+		perror("[KFMon] [ERR!] Aborting: inotify_init1");
+		notify("[KFMon] Failed to initialize inotify!");
+		exit(EXIT_FAILURE);
+	}
+	inotify_fd = fd;
+
+	// Inotify input
+	pfds[PFD_INOTIFY].fd     = fd;
+	pfds[PFD_INOTIFY].events = POLLIN;
+	// Mountpoint activity (c.f., refresh_mount_state), so we can let go of everything on the target mountpoint
+	// in time, and re-arm our watches as soon as it's back.
+	pfds[PFD_MOUNTS].fd     = mount_state.fd;
+	pfds[PFD_MOUNTS].events = POLLPRI;
+	// Signals (including SIGCHLD, if we can't use pidfds)
+	pfds[PFD_SIGNALS].fd     = signal_fd;
+	pfds[PFD_SIGNALS].events = POLLIN;
+	// Our DB wait tick
+	pfds[PFD_DB_WAIT].fd     = db_wait.timer_fd;
+	pfds[PFD_DB_WAIT].events = POLLIN;
+	// Our debounce timer
+	pfds[PFD_DEBOUNCE].fd     = debounce_timer_fd;
+	pfds[PFD_DEBOUNCE].events = POLLIN;
+	// Our control socket (if any, poll simply skips negative fds)
+	pfds[PFD_CONTROL].fd     = control_fd;
+	pfds[PFD_CONTROL].events = POLLIN;
+	// Our launcher (if any, c.f., handle_launcher)
+	pfds[PFD_LAUNCHER].events = POLLIN;
+
+	// Our target mountpoint may have gone away since we loaded our config...
+	if (is_target_mounted()) {
+		arm_watches(fd);
+	} else {
+		LOG(LOG_NOTICE, "%s isn't mounted, waiting for it to be . . .", KFMON_TARGET_MOUNTPOINT);
 	}
 
-	// We pretty much want to loop forever...
+	// We pretty much want to loop forever, waiting for events...
+	LOG(LOG_INFO, "Listening for events.");
 	while (1) {
-		LOG(LOG_INFO, "Beginning the main loop.");
-
-		// Create the file descriptor for accessing the inotify API
-		LOG(LOG_INFO, "Initializing inotify.");
-		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
-		if (fd == -1) {
-			perror("[KFMon] [ERR!] Aborting: inotify_init1");
-			fbink_print(FBFD_AUTO, "[KFMon] Failed to initialize inotify!", &fbink_config);
-			exit(EXIT_FAILURE);
+		// Our process table may have grown after a config reload, follow it
+		if (PT.size > pfds_pt_size) {
+			struct pollfd* new_pfds = realloc(pfds, (PFD_COUNT + PT.size) * sizeof(*pfds));
+			if (new_pfds == NULL) {
+				perror("[KFMon] [ERR!] Aborting: realloc");
+				exit(EXIT_FAILURE);
+			}
+			pfds = new_pfds;
+			size_t* new_pfd_pt_entries = realloc(pfd_pt_entries, PT.size * sizeof(*pfd_pt_entries));
+			if (new_pfd_pt_entries == NULL) {
+				perror("[KFMon] [ERR!] Aborting: realloc");
+				exit(EXIT_FAILURE);
+			}
+			pfd_pt_entries = new_pfd_pt_entries;
+			pfds_pt_size   = PT.size;
 		}
 
-		// Make sure our target file is available (i.e., the partition it resides in is mounted)
-		if (!is_target_mounted()) {
-			LOG(LOG_INFO, "%s isn't mounted, waiting for it to be . . .", KFMON_TARGET_MOUNTPOINT);
-			// If it's not, wait for it to be...
-			wait_for_target_mountpoint();
-		}
-
-		// Flag each of our target files for 'file was opened' and 'file was closed' events
-		// NOTE: We don't check for:
-		//       IN_MODIFY: Highly unlikely (and sandwiched between an OPEN and a CLOSE anyway)
-		//       IN_CREATE: Only applies to directories
-		//       IN_DELETE: Only applies to directories
-		//       IN_DELETE_SELF: Will trigger an IN_IGNORED, which we already handle
-		//       IN_MOVE_SELF: Highly unlikely on a Kobo, and somewhat annoying to handle with our design
-		//           (we'd have to forget about it entirely and not try to re-watch for it
-		//           on the next iteration of the loop).
-		// NOTE: inotify tracks the file's inode, which means that it goes *through* bind mounts, for instance:
-		//           When bind-mounting file 'a' to file 'b', and setting up a watch to the path of file 'b',
-		//           you won't get *any* event on that watch when unmounting that bind mount, since the original
-		//           file 'a' hasn't actually been touched, and, as it is the actual, real file,
-		//           that is what inotify is actually tracking.
-		//       Relative to the earlier IN_MOVE_SELF mention, that means it'll keep tracking the file with its
-		//           new name (provided it was moved to the *same* fs,
-		//           as crossing a fs boundary will delete the original).
-		for (uint8_t watch_idx = 0; watch_idx < watch_count; watch_idx++) {
-			watch_config[watch_idx].inotify_wd =
-			    inotify_add_watch(fd, watch_config[watch_idx].filename, IN_OPEN | IN_CLOSE);
-			if (watch_config[watch_idx].inotify_wd == -1) {
-				perror("[KFMon] [WARN] inotify_add_watch");
-				LOG(LOG_WARNING, "Cannot watch '%s', discarding it!", watch_config[watch_idx].filename);
-				fbink_printf(FBFD_AUTO,
-					     NULL,
-					     &fbink_config,
-					     "[KFMon] Failed to watch %s!",
-					     basename(watch_config[watch_idx].filename));
-				// NOTE: We used to abort entirely in case even one target file couldn't be watched,
-				//       but that was a bit harsh ;).
-				//       Since the inotify watch couldn't be setup,
-				//       there's no way for this to cause trouble down the road,
-				//       and this allows the user to fix it during an USBMS session instead of having to reboot,
-				//       provided no config tweaks are needed (as we still only parse configs at boot)...
-			} else {
-				LOG(LOG_NOTICE,
-				    "Setup an inotify watch for '%s' @ index %hhu.",
-				    watch_config[watch_idx].filename,
-				    watch_idx);
+		// We may have lost our launcher since the last time around
+		pfds[PFD_LAUNCHER].fd = launcher_fd;
+
+		// Append the pidfds of our running spawns
+		nfds_t nfds = PFD_COUNT;
+		if (use_pidfd) {
+			for (size_t i = 0U; i < PT.size; i++) {
+				if (PT.spawn_pidfds[i] != -1) {
+					pfd_pt_entries[nfds - PFD_COUNT] = i;
+					pfds[nfds].fd                    = PT.spawn_pidfds[i];
+					pfds[nfds].events                = POLLIN;
+					pfds[nfds].revents               = 0;
+					nfds++;
+				}
 			}
 		}
 
-		// Inotify input
-		pfd.fd     = fd;
-		pfd.events = POLLIN;
+		poll_num = poll(pfds, nfds, -1);
+		if (poll_num == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("[KFMon] [ERR!] Aborting: poll");
+			notify("[KFMon] poll failed ?!");
+			exit(EXIT_FAILURE);
+		}
 
-		// Wait for events
-		LOG(LOG_INFO, "Listening for events.");
-		while (1) {
-			poll_num = poll(&pfd, 1, -1);
-			if (poll_num == -1) {
-				if (errno == EINTR) {
-					continue;
+		if (poll_num > 0) {
+			if (pfds[PFD_MOUNTS].revents & (POLLERR | POLLPRI)) {
+				// The mount table changed, our watches may need to follow suit
+				handle_mount_change(fd);
+			}
+			// Reap our dead spawns first, so that they don't prevent a relaunch
+			if (pfds[PFD_SIGNALS].revents & POLLIN) {
+				handle_signals();
+				// That includes SIGHUP, which asks us to reload our configs
+				if (config_reload_requested) {
+					reload_configs(fd);
 				}
-				perror("[KFMon] [ERR!] Aborting: poll");
-				fbink_print(FBFD_AUTO, "[KFMon] poll failed ?!", &fbink_config);
-				exit(EXIT_FAILURE);
 			}
-
-			if (poll_num > 0) {
-				if (pfd.revents & POLLIN) {
-					// Inotify events are available
-					if (handle_events(fd)) {
-						// Go back to the main loop if we exited early (because a watch was
-						// destroyed automatically after an unmount or an unlink, for instance)
-						break;
-					}
+			for (nfds_t n = PFD_COUNT; n < nfds; n++) {
+				if (pfds[n].revents & POLLIN) {
+					handle_pidfd(pfd_pt_entries[n - PFD_COUNT]);
 				}
 			}
+			if (pfds[PFD_LAUNCHER].revents & (POLLIN | POLLHUP | POLLERR)) {
+				// Our launcher's spawns died (or it did)
+				handle_launcher();
+			}
+			if (pfds[PFD_DB_WAIT].revents & POLLIN) {
+				// Check on Nickel's DB again, we may have a launch to go through with
+				handle_db_wait(true);
+			}
+			if (pfds[PFD_DEBOUNCE].revents & POLLIN) {
+				// A burst of events has settled down, see what we should make of it
+				handle_debounce_timer();
+			}
+			if (pfds[PFD_CONTROL].revents & POLLIN) {
+				// Someone wants to talk to us
+				handle_control_connection();
+			}
+			if (pfds[PFD_INOTIFY].revents & POLLIN) {
+				// Inotify events are available
+				handle_events(fd);
+			}
 		}
-		LOG(LOG_INFO, "Stopped listening for events.");
-
-		// Close inotify file descriptor
-		close(fd);
 	}
 
 	// Why, yes, this is unreachable! Good thing it's also optional ;).
@@ -25,27 +25,42 @@
 #endif
 
 #include "FBInk/fbink.h"
+#include "control.h"
 #include "inih/ini.h"
+#include "journal.h"
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
-#include <fts.h>
 #include <limits.h>
+#include <linux/fb.h>
 #include <linux/limits.h>
+#include <linux/magic.h>
 #include <mntent.h>
 #include <poll.h>
 #include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <sqlite3.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
 #include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
 #include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/statfs.h>
 #include <sys/syscall.h>
 #include <sys/time.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 #include <syslog.h>
 #include <time.h>
@@ -61,14 +76,34 @@
 #	define KFMON_TARGET_MOUNTPOINT "/mnt/onboard"
 #endif
 // Use my debug paths on demand...
-#ifndef NILUJE
-#	define KOBO_DB_PATH KFMON_TARGET_MOUNTPOINT "/.kobo/KoboReader.sqlite"
+#if defined(KFMON_BENCH)
+// The bench harness (c.f., bench/kfmon_bench.c) keeps everything in a scratch directory
+#	define KOBO_DB_DIR KFMON_TARGET_MOUNTPOINT "/.kobo"
+#	define KOBO_DB_PATH KOBO_DB_DIR "/KoboReader.sqlite"
+#	define KFMON_LOGFILE KFMON_BENCH_DIR "/kfmon.log"
+#	define KFMON_CONFIGPATH KFMON_BENCH_DIR "/config"
+#	define KFMON_PROCESSED_CACHE KFMON_BENCH_DIR "/processed.cache"
+#	define KFMON_CONFIG_SNAPSHOT KFMON_BENCH_DIR "/config.snapshot"
+#	define KFMON_JOURNAL KFMON_BENCH_DIR "/kfmon.journal"
+#	define KFMON_CONTROL_SOCKET KFMON_BENCH_DIR "/kfmon.sock"
+#elif !defined(NILUJE)
+#	define KOBO_DB_DIR KFMON_TARGET_MOUNTPOINT "/.kobo"
+#	define KOBO_DB_PATH KOBO_DB_DIR "/KoboReader.sqlite"
 #	define KFMON_LOGFILE "/usr/local/kfmon/kfmon.log"
 #	define KFMON_CONFIGPATH KFMON_TARGET_MOUNTPOINT "/.adds/kfmon/config"
+#	define KFMON_PROCESSED_CACHE "/usr/local/kfmon/processed.cache"
+#	define KFMON_CONFIG_SNAPSHOT "/usr/local/kfmon/config.snapshot"
+#	define KFMON_JOURNAL "/usr/local/kfmon/kfmon.journal"
+#	define KFMON_CONTROL_SOCKET "/tmp/kfmon.sock"
 #else
-#	define KOBO_DB_PATH "/home/niluje/Kindle/Staging/KoboReader.sqlite"
+#	define KOBO_DB_DIR "/home/niluje/Kindle/Staging"
+#	define KOBO_DB_PATH KOBO_DB_DIR "/KoboReader.sqlite"
 #	define KFMON_LOGFILE "/home/niluje/Kindle/Staging/kfmon.log"
 #	define KFMON_CONFIGPATH "/home/niluje/Kindle/Staging/kfmon"
+#	define KFMON_PROCESSED_CACHE "/home/niluje/Kindle/Staging/processed.cache"
+#	define KFMON_CONFIG_SNAPSHOT "/home/niluje/Kindle/Staging/config.snapshot"
+#	define KFMON_JOURNAL "/home/niluje/Kindle/Staging/kfmon.journal"
+#	define KFMON_CONTROL_SOCKET "/home/niluje/Kindle/Staging/kfmon.sock"
 #endif
 
 // MIN/MAX with no side-effects,
@@ -89,27 +124,16 @@
 	})
 
 // NOTE: See https://kernelnewbies.org/FAQ/DoWhile0 for the reasoning behind the use of GCC's ({ … }) notation
-// Log everything to stderr (which actually points to our logfile)
+// Log everything to stderr (which actually points to our logfile), via our async logger (c.f., log_record)
 #define LOG(prio, fmt, ...)                                                                                              \
 	({                                                                                                               \
 		if (daemon_config.use_syslog) {                                                                          \
 			syslog(prio, fmt "\n", ##__VA_ARGS__);                                                           \
 		} else {                                                                                                 \
-			fprintf(stderr,                                                                                  \
-				"[KFMon] [%s] [%s] " fmt "\n",                                                           \
-				get_current_time(),                                                                      \
-				get_log_prefix(prio),                                                                    \
-				##__VA_ARGS__);                                                                          \
-		}                                                                                                        \
-	})
-
-// Slight variation without date/time handling to ensure thread safety
-#define MTLOG(fmt, ...)                                                                                                  \
-	({                                                                                                               \
-		if (daemon_config.use_syslog) {                                                                          \
-			syslog(LOG_NOTICE, fmt "\n", ##__VA_ARGS__);                                                     \
-		} else {                                                                                                 \
-			fprintf(stderr, "[KFMon] " fmt "\n", ##__VA_ARGS__);                                             \
+			log_record("[KFMon] [%s] [%s] " fmt "\n",                                                         \
+				   get_current_time(),                                                                   \
+				   get_log_prefix(prio),                                                                 \
+				   ##__VA_ARGS__);                                                                       \
 		}                                                                                                        \
 	})
 
@@ -145,96 +169,700 @@ typedef struct
 	unsigned short int db_timeout;
 	bool               use_syslog;
 	bool               with_notifications;
+	bool               use_journal;
+	bool               use_launcher;
 } DaemonConfig;
 
+// What we remember about a target icon once we've confirmed that Nickel has fully processed it
+typedef struct
+{
+	char     image_id[KFMON_PATH_MAX];
+	uint64_t ino;
+	int64_t  size;
+	int64_t  mtime;
+	uint32_t title_hash;
+	bool     is_valid;
+} ProcessedFingerprint;
+
+// The thumbnails Nickel generates for a book, which we expect to find before considering it fully processed
+typedef enum
+{
+	THUMBNAIL_N3_FULL = 0U,       // Full-size screensaver
+	THUMBNAIL_N3_LIBRARY_FULL,    // Homescreen tile
+	THUMBNAIL_N3_LIBRARY_GRID,    // Library thumbnail
+	THUMBNAIL_KIND_COUNT
+} ThumbnailKind;
+#define THUMBNAILS_ALL ((1U << THUMBNAIL_KIND_COUNT) - 1U)
+
+// What we know about a target icon's thumbnails
+typedef struct
+{
+	char    image_id[KFMON_PATH_MAX];    // The ImageID the rest of the state applies to
+	int     dfd;                         // Cached fd on its .kobo-images/<dir1>/<dir2> directory
+	int     wd;                          // inotify watch on that directory, while we're waiting for thumbnails
+	uint8_t found;                       // Bitmask of the thumbnails we know exist
+	bool    is_ready;                    // Flipped by inotify when the last one showed up
+} ThumbnailState;
+
+// The stages of the event -> launch path we keep latency stats for
+typedef enum
+{
+	LAT_PROCESSED_CHECK = 0U,    // is_target_processed(), from start to finish
+	LAT_THUMBNAIL_PROBE,         // Checking that Nickel has generated the thumbnails
+	LAT_JOURNAL_WAIT,            // Waiting for Nickel's DB to settle down (c.f., defer_launch)
+	LAT_SPAWN,                   // vfork() -> successful exec
+	LAT_EVENT_TO_LAUNCH,         // inotify read() -> successful exec
+	LAT_STAGE_COUNT
+} LatencyStage;
+
+// Fixed log2 buckets, in us: bucket n counts samples < 2^n us, the last one catches everything else (>= ~4s)
+#define LAT_BUCKET_COUNT 23U
+typedef struct
+{
+	uint32_t buckets[LAT_BUCKET_COUNT];
+	uint32_t count;
+	uint64_t total_us;
+	uint64_t max_us;
+} LatencyHistogram;
+
+// Where a watch stands, between an event on its target and the death of its action (c.f., next_watch_state)
+typedef enum
+{
+	WATCH_IDLE = 0U,    // Nothing going on
+	WATCH_OPENED,       // Its target was opened, and Nickel had already processed it
+	WATCH_PENDING,      // Its target was opened before Nickel was done processing it
+	WATCH_READY,        // Its target was closed, and it's good to go, but Nickel's DB is busy (c.f., defer_launch)
+	WATCH_SPAWNED,      // We've forked, and are waiting to hear back from execvp
+	WATCH_RUNNING,      // Its action is running
+	WATCH_STATE_COUNT
+} WatchState;
+
+// What drives it from one state to the next
+typedef enum
+{
+	WATCH_EV_OPEN_PROCESSED = 0U,    // IN_OPEN, Nickel has processed its target
+	WATCH_EV_OPEN_UNPROCESSED,       // IN_OPEN, Nickel hasn't processed its target (yet?)
+	WATCH_EV_CLOSE_PROCESSED,        // IN_CLOSE, Nickel has processed its target
+	WATCH_EV_CLOSE_UNPROCESSED,      // IN_CLOSE, Nickel hasn't processed its target, or it was pending on IN_OPEN
+	WATCH_EV_LAUNCH,                 // We're launching its action (c.f., launch_watch)
+	WATCH_EV_EXEC_OK,                // Its action is up (c.f., add_process_to_table)
+	WATCH_EV_EXEC_FAILED,            // Its action failed to launch
+	WATCH_EV_REAPED,                 // Its action died (c.f., remove_process_from_table)
+	WATCH_EV_CANCEL,                 // Whatever it was up to is moot (f.g., a spawn blocker is running)
+	WATCH_EV_COUNT
+} WatchEvent;
+
+// What we can set up for a watch's spawns before they exec (c.f., apply_spawn_attrs)
+#ifndef KFMON_CGROUP_ROOT
+#	define KFMON_CGROUP_ROOT "/sys/fs/cgroup"
+#endif
+// ioprio_set isn't wrapped by glibc, and its constants live in a kernel header that isn't exported...
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_RT    1
+#define IOPRIO_CLASS_BE    2
+#define IOPRIO_CLASS_IDLE  3
+#define IOPRIO_WHO_PROCESS 1
+typedef enum
+{
+	SPAWN_EXEC          = 0U,    // Not an attribute, stands for execvp itself when reporting failures
+	SPAWN_NICE          = 1U << 0U,
+	SPAWN_SCHED         = 1U << 1U,
+	SPAWN_IOPRIO        = 1U << 2U,
+	SPAWN_IOPRIO_LEVEL  = 1U << 3U,
+	SPAWN_CPU_AFFINITY  = 1U << 4U,
+	SPAWN_OOM_SCORE_ADJ = 1U << 5U,
+	SPAWN_RLIMITS       = 1U << 6U,
+	SPAWN_CGROUP        = 1U << 7U,
+} SpawnAttrFlag;
+
+// The rlimits that can be set per watch, as rlimit_<name> keys (f.g., rlimit_nofile = 256)
+typedef struct
+{
+	const char* key;
+	int         resource;
+} RlimitKey;
+static const RlimitKey rlimit_keys[] = {
+	{ "rlimit_as", RLIMIT_AS },       { "rlimit_core", RLIMIT_CORE },       { "rlimit_cpu", RLIMIT_CPU },
+	{ "rlimit_data", RLIMIT_DATA },   { "rlimit_fsize", RLIMIT_FSIZE },     { "rlimit_memlock", RLIMIT_MEMLOCK },
+	{ "rlimit_nice", RLIMIT_NICE },   { "rlimit_nofile", RLIMIT_NOFILE },   { "rlimit_nproc", RLIMIT_NPROC },
+	{ "rlimit_rss", RLIMIT_RSS },     { "rlimit_rtprio", RLIMIT_RTPRIO },   { "rlimit_stack", RLIMIT_STACK },
+};
+
+// NOTE: Plain data (and no padding), so that it can be compared, stored in our config snapshot,
+//       and sent over to our launcher as-is.
+typedef struct
+{
+	uint64_t      cpu_affinity;                 // One bit per CPU
+	struct rlimit rlimits[RLIM_NLIMITS];        // Applied to both the soft & hard limits
+	uint32_t      mask;                         // Which of these are actually set (c.f., SpawnAttrFlag)
+	uint32_t      rlimit_mask;                  // Which rlimits are set, one bit per resource
+	int           nice;
+	int           sched_policy;
+	int           sched_priority;
+	int           ioprio_class;
+	int           ioprio_level;
+	int           oom_score_adj;
+	char          cgroup[KFMON_PATH_MAX];       // cgroup v2 group to put them in, relative to KFMON_CGROUP_ROOT
+} SpawnAttrs;
+
 // What a watch config should look like
 typedef struct
 {
-	char filename[KFMON_PATH_MAX];
-	char action[KFMON_PATH_MAX];
-	char db_title[DB_SZ_MAX];
-	char db_author[DB_SZ_MAX];
-	char db_comment[DB_SZ_MAX];
-	int  inotify_wd;
-	bool skip_db_checks;
-	bool do_db_update;
-	bool block_spawns;
-	bool wd_was_destroyed;
+	char                 filename[KFMON_PATH_MAX];
+	char                 action[KFMON_PATH_MAX];
+	char                 db_title[DB_SZ_MAX];
+	char                 db_author[DB_SZ_MAX];
+	char                 db_comment[DB_SZ_MAX];
+	char                 config_file[NAME_MAX + 1];    // Basename of the ini file this watch was loaded from
+	int                  inotify_wd;
+	int                  parent_wd;    // inotify watch on the directory holding its target (c.f., arm_parent_watch)
+	bool                 skip_db_checks;
+	bool                 do_db_update;
+	bool                 block_spawns;
+	unsigned short int   debounce_ms;    // Coalesce its events within that many ms (c.f., debounce_event)
+	SpawnAttrs           spawn_attrs;
+	bool                 is_retired;            // Config file is gone, slot kept until its spawn (if any) is reaped
+	WatchState           state;                 // Where it stands (c.f., next_watch_state)
+	struct timespec      deferred_event_ts;     // When we caught the event behind that deferred launch
+	bool                 is_debouncing;         // We're in the middle of a burst of events
+	size_t               debounce_pos;          // Where it stands in debouncing_watches, while it is
+	uint32_t             debounce_mask;         // The events we've held back from the current burst
+	size_t               debounce_events;       // How many of them there were
+	struct timespec      debounce_event_ts;     // When we caught the latest one
+	struct timespec      debounce_deadline;     // When the current burst will be deemed settled
+	size_t               coalesced_checks;      // How many checks we've saved that way
+	uint32_t             batch_mask;            // What we've caught for it in the current batch (c.f., handle_events)
+	size_t               batch_events;          // How many IN_OPEN/IN_CLOSE events that was
+	bool                 is_batch_reopened;     // It was opened again after the last IN_CLOSE of that batch
+	pid_t                spawn_pid;             // Its running action, if any (c.f., add_process_to_table)
+	size_t               spawn_count;           // How many times we've launched it
+	bool                 is_spawn_blocker;      // Whether its running action blocks every other spawn
+	ProcessedFingerprint fingerprint;
+	ThumbnailState       thumbnails;
+	LatencyHistogram     latency[LAT_STAGE_COUNT];
 } WatchConfig;
 
-// Hardcode the max amount of watches we handle
-// NOTE: Cannot exceed INT8_MAX!
-#define WATCH_MAX 16
+// On-disk layout of our processed cache: a header, followed by count records
+#define KFMON_PROCESSED_CACHE_MAGIC   "KFMC"
+#define KFMON_PROCESSED_CACHE_VERSION 1U
+typedef struct
+{
+	char     magic[4];
+	uint32_t version;
+	uint32_t count;
+} ProcessedCacheHeader;
+
+typedef struct
+{
+	char                 filename[KFMON_PATH_MAX];
+	ProcessedFingerprint fingerprint;
+} ProcessedCacheRecord;
+
+// On-disk layout of our config snapshot: a header, followed by file_count file records, then watch_count watch records.
+// The file records describe the state of our config directory the snapshot was built from.
+#define KFMON_CONFIG_SNAPSHOT_MAGIC   "KFMS"
+#define KFMON_CONFIG_SNAPSHOT_VERSION 4U
+typedef struct
+{
+	char         magic[4];
+	uint32_t     version;
+	uint32_t     file_count;
+	uint32_t     watch_count;
+	uint64_t     parse_us;    // How long the full parse it was built from took
+	DaemonConfig daemon;
+} ConfigSnapshotHeader;
+
+typedef struct
+{
+	char    name[NAME_MAX + 1];
+	int64_t size;
+	int64_t mtime;    // In ns
+} ConfigSnapshotFile;
+
+typedef struct
+{
+	char               filename[KFMON_PATH_MAX];
+	char               action[KFMON_PATH_MAX];
+	char               db_title[DB_SZ_MAX];
+	char               db_author[DB_SZ_MAX];
+	char               db_comment[DB_SZ_MAX];
+	char               config_file[NAME_MAX + 1];
+	bool               skip_db_checks;
+	bool               do_db_update;
+	bool               block_spawns;
+	unsigned short int debounce_ms;
+	SpawnAttrs         spawn_attrs;
+} ConfigSnapshotWatch;
 
 // Used to keep track of our spawned processes, by storing their pids, and their watch idx.
 // c.f., https://stackoverflow.com/a/35235950 & https://stackoverflow.com/a/8976461
 // As well as issue #2 for details of past failures w/ a SIGCHLD handler
+// NOTE: Reaping now happens from the main loop, via a pidfd per spawn, or a signalfd for SIGCHLD on older kernels,
+//       so everything here is only ever touched by a single thread.
+// NOTE: Since a watch can only ever have a single running spawn, the table is sized after our watch registry,
+//       and we keep a stack of available entries around, so we never have to walk the table to find one.
+// NOTE: Each watch also keeps track of its own running spawn, and we keep count of the running spawn blockers,
+//       so the checks we run on every event never have to walk the table either.
 struct process_table
 {
-	pid_t spawn_pids[WATCH_MAX];
+	pid_t* spawn_pids;
 	// NOTE: Needs to be signed because we use -1 as a special value meaning 'available'.
-	int8_t spawn_watchids[WATCH_MAX];
+	ssize_t* spawn_watchids;
+	int*     spawn_pidfds;
+	size_t*  free_entries;
+	size_t   free_count;
+	size_t   size;
 } PT;    // lgtm [cpp/short-global-name]
-pthread_mutex_t ptlock = PTHREAD_MUTEX_INITIALIZER;
-static void     init_process_table(void);
-static int8_t   get_next_available_pt_entry(void);
-static void     add_process_to_table(uint8_t, pid_t, uint8_t);
-static void     remove_process_from_table(uint8_t);
+size_t         running_blockers = 0U;
+static int     init_process_table(void);
+static int     grow_process_table(size_t);
+static ssize_t get_next_available_pt_entry(void);
+static void    add_process_to_table(size_t, pid_t, size_t);
+static void    remove_process_from_table(size_t);
+
+// pidfd_open was introduced in Linux 5.3, and our TC's headers may very well predate that...
+#ifndef SYS_pidfd_open
+#	define SYS_pidfd_open 434
+#endif
+// Whether we can reap via pidfds, or have to rely on SIGCHLD
+bool use_pidfd = false;
+// The signals we handle synchronously, via a signalfd
+int         signal_fd = -1;
+sigset_t    orig_sigmask;
+static int  init_signals(void);
+static void handle_signals(void);
+static void reap_process(size_t, int);
+static void handle_pidfd(size_t);
+static void reap_children(void);
+
+// Our pre-forked launcher (c.f., start_launcher), which does the actual fork + exec of our spawns on our behalf.
+// NOTE: Requests & replies are fixed-size, and go over a SOCK_SEQPACKET socketpair, so each of them is one message.
+typedef struct
+{
+	uint32_t   watch_idx;
+	char       action[KFMON_PATH_MAX];
+	SpawnAttrs attrs;
+} LauncherRequest;
+
+typedef enum
+{
+	LAUNCHER_SPAWNED = 0U,    // Reply to a request: pid is the spawn's, or -1, in which case status is an errno
+	LAUNCHER_EXITED,          // One of its spawns died: status is its wait status
+} LauncherReplyType;
+
+typedef struct
+{
+	uint32_t type;    // LauncherReplyType
+	uint32_t watch_idx;
+	pid_t    pid;
+	int      status;
+} LauncherReply;
+
+int          launcher_fd  = -1;
+pid_t        launcher_pid = -1;
+static int   start_launcher(void);
+static void  run_launcher(int) __attribute__((noreturn));
+static void  stop_launcher(void);
+static void  lose_launcher(void);
+static bool  launch_via_launcher(const char*, size_t, pid_t*, int*);
+static void  handle_launcher_reply(const LauncherReply*);
+static void  handle_launcher(void);
+
+// What we've prepared ahead of time to apply a watch's SpawnAttrs in a vfork child (c.f., apply_spawn_attrs)
+typedef struct
+{
+	char      cgroup_procs[KFMON_PATH_MAX + sizeof(KFMON_CGROUP_ROOT "/" "/cgroup.procs")];
+	char      oom_score_adj[16];
+	size_t    oom_score_adj_len;
+	cpu_set_t cpu_set;
+	int       ioprio;
+} SpawnPrep;
+// What the child tells us went wrong (c.f., fork_exec)
+typedef struct
+{
+	uint32_t stage;    // SpawnAttrFlag (SPAWN_EXEC for execvp itself)
+	int      err;
+} SpawnError;
+static const char* get_spawn_attr_name(uint32_t) __attribute__((const));
+static void        append_spawn_attr(char*, size_t, size_t*, const char*, ...) __attribute__((format(printf, 4, 5)));
+static void        format_spawn_attrs(const SpawnAttrs*, char*, size_t);
+static int         prepare_spawn_attrs(const SpawnAttrs*, SpawnPrep*);
+static uint32_t    apply_spawn_attrs(const SpawnAttrs*, const SpawnPrep*);
+static pid_t       fork_exec(char* const*, const SpawnAttrs*, int*);
+
+// When we read the inotify event we're currently handling
+struct timespec    event_ts = { 0 };
+static void        get_monotonic_time(struct timespec*);
+static uint64_t    get_elapsed_us(const struct timespec*);
+static void        record_latency(size_t, LatencyStage, const struct timespec*);
+static const char* get_latency_stage_name(LatencyStage) __attribute__((const));
+static void        dump_latency_histograms(void);
 
 static void init_fbink_config(void);
 
+// The bits of the fb setup FBInk cares about, so we only ever reinit it when they actually change (c.f., refresh_fbink)
+// NOTE: Only ever touched from the main thread, like the rest of FBInk's state.
+#ifndef KFMON_FB_DEVICE
+#	define KFMON_FB_DEVICE "/dev/fb0"
+#endif
+typedef struct
+{
+	int      fd;    // Kept open, so that a probe is a single ioctl
+	uint32_t xres;
+	uint32_t yres;
+	uint32_t bits_per_pixel;
+	uint32_t rotate;
+} FbState;
+FbState     fb_state = { -1, 0U, 0U, 0U, 0U };
+static void init_fb_state(void);
+static bool probe_fb_state(void);
+static void refresh_fbink(void);
+
 // SQLite macros inspired from http://www.lemoda.net/c/sqlite-insert/ :)
+// NOTE: Since our statements are long-lived, make sure we don't leave one of them half-way through a step on failure,
+//       as that would keep a read transaction open behind Nickel's back...
 #define CALL_SQLITE(f)                                                                                                   \
 	({                                                                                                               \
 		int i;                                                                                                   \
 		i = sqlite3_##f;                                                                                         \
 		if (i != SQLITE_OK) {                                                                                    \
 			LOG(LOG_CRIT, "%s failed with status %d: %s", #f, i, sqlite3_errmsg(db));                        \
+			reset_nickel_db_stmts();                                                                         \
 			return is_processed;                                                                             \
 		}                                                                                                        \
 	})
 
+// Our long-lived connection to Nickel's DB, as well as the statements we keep prepared on it
+typedef struct
+{
+	sqlite3*      db;
+	sqlite3_stmt* content_stmt;
+	sqlite3_stmt* update_stmt;
+	dev_t         db_dev;
+	ino_t         db_ino;
+	bool          is_rw;
+	int           shm_fd;    // Our own fd on the wal-index, to check its locks (c.f., is_nickel_db_quiescent)
+	dev_t         shm_dev;
+	ino_t         shm_ino;
+} NickelDB;
+NickelDB nickel_db = { .shm_fd = -1 };
+
+// Keep track of how many SQL statements we actually run, vs. how many the original one query per check design would have
+typedef struct
+{
+	unsigned long int queries;
+	unsigned long int legacy_queries;
+} DBStats;
+DBStats     db_stats = { 0 };
+static int  open_nickel_db(bool);
+static void close_nickel_db(void);
+static bool is_nickel_db_stale(void);
+static void reset_nickel_db_stmts(void);
+
+// Launches we've put on hold until Nickel's DB is quiescent (c.f., defer_launch)
+#define DB_WAIT_TICK_MS    20L
+#define DB_WAIT_TIMEOUT_MS 10000U
+// The wal-index header (c.f., https://www.sqlite.org/walformat.html#the_wal_index_file_format):
+// the WAL_WRITE_LOCK & WAL_CKPT_LOCK bytes are held while a write transaction or a checkpoint is running.
+#define WAL_SHM_LOCK_OFFSET 120
+#define WAL_SHM_LOCK_COUNT  2
+typedef struct
+{
+	int             timer_fd;    // Periodic re-check tick (lock releases don't trip any inotify event)
+	int             wd;          // inotify watch on Nickel's DB directory
+	size_t          count;       // How many watches have a launch on hold
+	struct timespec started;     // When we started waiting
+} DbWait;
+DbWait      db_wait = { -1, -1, 0U, { 0L, 0L } };
+static bool is_nickel_db_quiescent(void);
+static void defer_launch(size_t);
+static void stop_db_wait(void);
+static void handle_db_wait(bool);
+static void cancel_deferred_launches(void);
+
+// Our binary event journal (c.f., journal.h), when enabled
+typedef struct
+{
+	JournalHeader* header;
+	JournalRecord* records;
+	size_t         map_size;
+} EventJournal;
+EventJournal journal = { 0 };
+static int   open_journal(void);
+static void  close_journal(void);
+static void  journal_event(ssize_t, uint32_t, JournalDecision, uint64_t, uint64_t, pid_t);
+
+// Our control socket (c.f., control.h)
+// NOTE: Connections are handled synchronously from the main loop, so don't let a client hold us hostage for long.
+#define CONTROL_TIMEOUT_MS 250L
+typedef struct
+{
+	char*  buf;    // Grown as needed
+	size_t size;
+	size_t len;
+} ControlReply;
+int            control_fd = -1;
+static int     open_control_socket(void);
+static void    close_control_socket(void);
+static void    control_printf(ControlReply*, const char*, ...) __attribute__((format(printf, 2, 3)));
+static ssize_t find_watch_by_name(const char*);
+static void    control_list(ControlReply*);
+static void    control_stats(ControlReply*);
+static void    control_trigger(ControlReply*, const char*);
+static void    handle_control_connection(void);
+
 // Remember stdin/stdout/stderr to restore them in our children
 int        orig_stdin;
 int        orig_stdout;
 int        orig_stderr;
 static int daemonize(void);
 
-struct tm*  get_localtime(struct tm*);
 char*       format_localtime(struct tm*, char*, size_t);
 char*       get_current_time(void);
-char*       get_current_time_r(struct tm*, char*, size_t);
 const char* get_log_prefix(int) __attribute__((const));
 
+// Our log records are preformatted by their producers, and pushed to a bounded lock-free MPSC ring
+// (c.f., http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue),
+// which is drained by a dedicated writer thread, that batches them in as few write() calls as possible.
+#define LOG_RING_SLOTS      256U    // Must be a power of two
+#define LOG_RECORD_MAX      512U
+#define LOG_BATCH_SIZE      (16U * 1024U)
+#define LOG_COALESCE_DELAY  50000000L    // ns
+typedef struct
+{
+	atomic_size_t seq;
+	size_t        len;
+	char          buf[LOG_RECORD_MAX];
+} LogRecord;
+typedef struct
+{
+	LogRecord     slots[LOG_RING_SLOTS];
+	atomic_size_t head;    // Next slot to claim (producers)
+	size_t        tail;    // Next slot to drain (writer thread only)
+	atomic_size_t dropped;
+	atomic_bool   is_writer_asleep;
+	atomic_bool   is_running;
+	int           wake_fd;
+	pthread_t     writer;
+} LogRing;
+LogRing log_ring = { 0 };
+void        log_record(const char*, ...) __attribute__((format(printf, 1, 2)));
+static bool log_ring_is_empty(void);
+static void log_write_all(const char*, size_t);
+void*       log_writer_thread(void*);
+static int  start_logger(void);
+static void stop_logger(void);
+
+// On-screen notifications are queued by the main thread, and shown by a dedicated notifier thread,
+// so that a (slow) e-ink refresh never holds up an event or a launch.
+#define NOTIFY_QUEUE_SLOTS    16U
+#define NOTIFY_MSG_MAX        256U
+#define NOTIFY_COALESCE_DELAY 150000000L    // ns
+#define NOTIFY_REPEAT_DELAY   5             // s, an identical message shown more recently than that is skipped
+#define NOTIFY_HISTORY        8U
+typedef struct
+{
+	char            msgs[NOTIFY_QUEUE_SLOTS][NOTIFY_MSG_MAX];
+	size_t          tail;    // Next message to show
+	size_t          count;
+	size_t          dropped;
+	bool            is_running;
+	pthread_mutex_t lock;
+	pthread_cond_t  cond;
+	pthread_t       notifier;
+} NotifyQueue;
+NotifyQueue notify_queue = { 0 };
+static void notify(const char*, ...) __attribute__((format(printf, 1, 2)));
+void*       notifier_thread(void*);
+static int  start_notifier(void);
+static void stop_notifier(void);
+
+// Our view of the mount table, as far as our target mountpoint is concerned.
+// NOTE: We keep /proc/self/mountinfo open for as long as we live, so that the kernel can let us know (via POLLPRI)
+//       whenever the mount table changes, and we only ever have to re-parse it then.
+typedef struct
+{
+	int    fd;
+	char*  buf;    // Read buffer, grown as needed
+	size_t buf_size;
+	bool   is_mounted;
+	int    mount_id;    // Unique for each mount, so we can tell a remount apart
+} MountState;
+MountState  mount_state = { -1, NULL, 0U, false, -1 };
+static int  open_mount_state(void);
+static bool refresh_mount_state(void);
 static bool is_target_mounted(void);
 static void wait_for_target_mountpoint(void);
 
 static int  strtoul_hu(const char*, unsigned short int*);
 static int  strtobool(const char*, bool*);
+static int  strtol_i(const char*, int, int, int*);
+static int  parse_sched_policy(const char*, int*);
+static int  parse_ioprio_class(const char*, int*);
+static int  parse_cpu_list(const char*, uint64_t*);
+static int  parse_rlimit(const char*, SpawnAttrs*, const char*);
+static bool is_cgroup_name_sane(const char*);
 static int  daemon_handler(void*, const char*, const char*, const char*);
 static int  watch_handler(void*, const char*, const char*, const char*);
 static bool validate_watch_config(void*);
+static bool claim_watch_filename(size_t);
+static bool claim_watch_config_file(size_t);
+static bool is_config_filename(const char*);
 static int  load_config(void);
-// Ugly global. Remember how many watches we set up...
-uint8_t watch_count = 0;
+static int  scan_config_dir(ConfigSnapshotFile**, size_t*);
+static int  compare_config_files(const void*, const void*);
+static const ConfigSnapshotFile* find_config_file(const ConfigSnapshotFile*, size_t, const char*);
+static void                      refresh_config_file(const char*);
+// The state of our config directory as of the last time we (re-)loaded it, sorted by name
+ConfigSnapshotFile* config_files      = NULL;
+size_t              config_file_count = 0U;
+static bool load_config_snapshot(const ConfigSnapshotFile*, size_t, uint64_t*);
+static void save_config_snapshot(const ConfigSnapshotFile*, size_t, uint64_t);
+// Hot config reloads (on SIGHUP, or via an inotify watch on our config directory)
+int         config_wd               = -1;
+bool        config_reload_requested = false;
+static void update_watch_config(size_t, const WatchConfig*);
+static void reload_daemon_config(const char*);
+static void reload_config_file(int, const char*);
+static void reload_configs(int);
+// Ugly globals. Remember how many watches we set up, and how many we have room for...
+size_t watch_count    = 0U;
+size_t watch_capacity = 0U;
+// ...and which of those slots belong to retired watches we can recycle (a stack, sized after watch_capacity).
+size_t*     free_watch_slots = NULL;
+size_t      free_watch_count = 0U;
+static void retire_watch_slot(size_t);
 // Make our config global, because I'm terrible at C.
+// NOTE: Our watch registry is growable, so watch_config is a plain array we realloc as needed:
+//       *never* hold a pointer to one of its elements across a call that may add a watch!
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wmissing-braces"
-DaemonConfig           daemon_config           = { 0 };
-WatchConfig            watch_config[WATCH_MAX] = { 0 };
-FBInkConfig            fbink_config            = { 0 };
+DaemonConfig daemon_config = { 0 };
+WatchConfig* watch_config  = NULL;
+FBInkConfig  fbink_config  = { 0 };
 #pragma GCC diagnostic push
+static ssize_t add_watch_config(void);
+
+// A tiny open-addressing hash table (linear probing), mapping a key to the index of the watch it belongs to.
+// The keys themselves live in the watch configs, the slots only remember their hash and the watch index.
+typedef struct
+{
+	size_t hash;
+	// NOTE: 0 means empty, SIZE_MAX means deleted, anything else is the watch idx + 1.
+	size_t idx;
+} WatchLookupSlot;
+typedef struct
+{
+	WatchLookupSlot* slots;
+	size_t           capacity;    // Always a power of two
+	size_t           used;        // Including deleted slots
+} WatchLookupTable;
+#define WLT_EMPTY   0U
+#define WLT_DELETED SIZE_MAX
+// Resolve an inotify watch descriptor, a target filename, or a config file to its watch idx in O(1)
+WatchLookupTable wd_table          = { 0 };
+WatchLookupTable filename_table    = { 0 };
+WatchLookupTable config_file_table = { 0 };
+// Resolve an inotify watch descriptor on a directory to the watch(es) keeping an eye on it
+WatchLookupTable parent_wd_table    = { 0 };
+WatchLookupTable thumbnail_wd_table = { 0 };
+static size_t    hash_filename(const char*);
+static int       wlt_resize(WatchLookupTable*, size_t);
+static int       wlt_insert(WatchLookupTable*, size_t, size_t);
+static void      wlt_remove(WatchLookupTable*, size_t, size_t);
+static void      wlt_clear(WatchLookupTable*);
+static ssize_t   wlt_find_next(const WatchLookupTable*, size_t, size_t*);
+static ssize_t   find_watch_by_wd(int);
+static ssize_t   find_watch_by_filename(const char*);
+static ssize_t   find_watch_by_config_file(const char*);
+static void      set_watch_wd(size_t, int);
+static void      set_parent_wd(size_t, int);
+static void      arm_parent_watch(int, size_t);
+static void      release_parent_watch(int, size_t);
+static bool      handle_parent_event(int, const struct inotify_event*);
+static void      arm_watch(int, size_t);
+static void      retire_watch(int, size_t);
+// The mount our watches are currently armed on, or -1 if they aren't (c.f., arm_watches)
+int              watches_mount_id = -1;
+static void      arm_watches(int);
+static void      disarm_watches(int);
+static void      handle_mount_change(int);
+static void      resync_watches(int);
 
+// Our current inotify instance (c.f., main), and a cached fd on Nickel's thumbnail directory
+int                 inotify_fd      = -1;
+int                 kobo_images_dfd = -1;
 static unsigned int qhash(const unsigned char*, size_t);
-static bool         is_target_processed(uint8_t, bool);
+static const char*  get_thumbnail_kind_name(ThumbnailKind) __attribute__((const));
+static void         get_thumbnail_subdir(const char*, char*, size_t);
+static void         get_thumbnail_name(const char*, ThumbnailKind, char*, size_t);
+static void         get_thumbnail_path(const char*, ThumbnailKind, char*, size_t);
+static int          open_thumbnail_dir(size_t, const char*);
+static uint8_t      stat_thumbnails(int, const char*);
+static bool         probe_thumbnails(size_t, const char*);
+static void         set_thumbnail_wd(size_t, int);
+static void         release_thumbnail_watch(size_t);
+static void         reset_thumbnail_state(size_t);
+static void         close_thumbnail_dirs(void);
+static bool         handle_thumbnail_event(const struct inotify_event*);
+static bool         is_target_processed_in_db(size_t, bool, char*);
+static void         load_processed_cache(void);
+static void         save_processed_cache(void);
+static bool         get_target_fingerprint(size_t, ProcessedFingerprint*);
+static bool         is_target_processed_cached(size_t);
+static void         remember_processed_target(size_t, const char*);
+static bool         is_target_processed(size_t, bool);
 
-void*        reaper_thread(void*);
-static pid_t spawn(char* const*, uint8_t);
+static pid_t spawn(char* const*, size_t);
+static pid_t launch_watch(size_t, uint64_t*);
 
-static bool  is_watch_already_spawned(uint8_t);
+static bool  is_watch_already_spawned(size_t);
 static bool  is_blocker_running(void);
-static pid_t get_spawn_pid_for_watch(uint8_t);
+static pid_t get_spawn_pid_for_watch(size_t);
 
-static bool handle_events(int);
+static const char* get_watch_state_name(WatchState) __attribute__((const));
+static const char* get_watch_event_name(WatchEvent) __attribute__((const));
+static WatchState  next_watch_state(WatchState, WatchEvent) __attribute__((const));
+static void        update_watch_state(size_t, WatchEvent);
+
+static JournalDecision handle_watch_event(size_t, uint32_t, uint64_t*, uint64_t*, pid_t*);
+// Our debounce timer (c.f., debounce_event), and the watches it's ticking for (sized like our registry)
+int                    debounce_timer_fd  = -1;
+size_t*                debouncing_watches = NULL;
+size_t                 debouncing_count   = 0U;
+static JournalDecision debounce_event(size_t, uint32_t, uint64_t*, uint64_t*, pid_t*);
+static void            stop_debouncing(size_t);
+static void            arm_debounce_timer(void);
+static void            handle_debounce_timer(void);
+static void            cancel_debounced_events(void);
+
+// What we've read from inotify in one go, and the watches it concerns, in order (c.f., handle_events)
+typedef struct
+{
+	char*   buf;    // Read buffer, sized after what's pending
+	size_t  buf_size;
+	size_t* watches;
+	size_t  watch_count;
+	size_t  watch_capacity;
+} EventBatch;
+EventBatch             event_batch = { NULL, 0U, NULL, 0U, 0U };
+static int             reserve_event_buffer(size_t);
+static void            batch_watch_event(size_t, uint32_t);
+static void            handle_batched_watch(size_t);
+static void            handle_destroyed_watch(int, size_t);
+static void            handle_events(int);
+
+// The fixed part of our poll set (c.f., main), the pidfds of our running spawns come after those
+typedef enum
+{
+	PFD_INOTIFY = 0U,
+	PFD_MOUNTS,
+	PFD_SIGNALS,
+	PFD_DB_WAIT,
+	PFD_DEBOUNCE,
+	PFD_CONTROL,
+	PFD_LAUNCHER,
+	PFD_COUNT
+} PollSlot;
 
 #endif
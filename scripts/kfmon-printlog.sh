@@ -4,11 +4,7 @@
 #
 ##
 
-# As D.Va would say, NERF THIS!
-# NOTE: There's a very good chance chrt won't actually be bundled in the Kobo's busybox, but, meh.
-chrt -b -p 0 $$
-renice -n 5 -p $$
-ionice -c 3 -p $$
+# NOTE: We're run at a low CPU & I/O priority by KFMon itself (c.f., nice, sched_policy & ioprio_class in kfmon-log.ini).
 
 # Pickup the FBInk binary we're shipping
 FBINK_BIN="/usr/local/kfmon/bin/fbink"
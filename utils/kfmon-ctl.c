@@ -0,0 +1,143 @@
+/*
+	KFMon: Kobo inotify-based launcher
+	Copyright (C) 2016-2019 NiLuJe <ninuje@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as
+	published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Talk to a running kfmon over its control socket (c.f., control.h).
+// f.g., kfmon-ctl list, kfmon-ctl stats, or kfmon-ctl trigger koreader.png
+
+#ifndef _GNU_SOURCE
+#	define _GNU_SOURCE
+#endif
+
+#include "../control.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef NILUJE
+#	define KFMON_CONTROL_SOCKET "/tmp/kfmon.sock"
+#else
+#	define KFMON_CONTROL_SOCKET "/home/niluje/Kindle/Staging/kfmon.sock"
+#endif
+
+static void usage(const char*);
+static int  write_all(int, const char*, size_t);
+
+static void
+    usage(const char* name)
+{
+	fprintf(stderr,
+		"Usage: %s <command> [argument]\n"
+		"\n"
+		"Commands:\n"
+		"\tlist\t\t\tList our watches, and what they're up to\n"
+		"\tstats\t\t\tDump our counters\n"
+		"\ttrigger <watch>\t\tLaunch a watch's action right away (watch: idx, config file, or target file)\n",
+		name);
+}
+
+static int
+    write_all(int fd, const char* buf, size_t len)
+{
+	while (len > 0U) {
+		ssize_t nwritten = write(fd, buf, len);
+		if (nwritten == -1) {
+			return -1;
+		}
+		buf += nwritten;
+		len -= (size_t) nwritten;
+	}
+	return 0;
+}
+
+int
+    main(int argc, char* argv[])
+{
+	if (argc < 2 || argc > 3 || strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
+		usage(argv[0]);
+		return argc < 2 ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	char cmd[KFMON_CONTROL_CMD_MAX];
+	int  len = snprintf(cmd, sizeof(cmd), "%s%s%s\n", argv[1], argc > 2 ? " " : "", argc > 2 ? argv[2] : "");
+	if (len < 0 || (size_t) len >= sizeof(cmd)) {
+		fprintf(stderr, "Command is too long!\n");
+		return EXIT_FAILURE;
+	}
+
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	strncpy(addr.sun_path, KFMON_CONTROL_SOCKET, sizeof(addr.sun_path) - 1U);    // Flawfinder: ignore
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd == -1) {
+		perror("[KFMon] [ERR!] socket");
+		return EXIT_FAILURE;
+	}
+	if (connect(fd, (const struct sockaddr*) &addr, sizeof(addr)) == -1) {
+		perror("[KFMon] [ERR!] connect (is kfmon running?)");
+		close(fd);
+		return EXIT_FAILURE;
+	}
+
+	// One command per connection: send it, and let kfmon know that's all it's getting
+	if (write_all(fd, cmd, (size_t) len) == -1 || shutdown(fd, SHUT_WR) == -1) {
+		perror("[KFMon] [ERR!] write");
+		close(fd);
+		return EXIT_FAILURE;
+	}
+
+	// Slurp the reply (it's never going to be huge)
+	char*   reply      = NULL;
+	size_t  reply_size = 0U;
+	size_t  reply_len  = 0U;
+	ssize_t nread;
+	do {
+		if (reply_len == reply_size) {
+			reply_size = reply_size ? reply_size * 2U : 4096U;
+			char* new_reply = realloc(reply, reply_size);
+			if (new_reply == NULL) {
+				perror("[KFMon] [ERR!] realloc");
+				free(reply);
+				close(fd);
+				return EXIT_FAILURE;
+			}
+			reply = new_reply;
+		}
+		nread = read(fd, reply + reply_len, reply_size - reply_len);    // Flawfinder: ignore
+		if (nread > 0) {
+			reply_len += (size_t) nread;
+		}
+	} while (nread > 0);
+	if (nread == -1) {
+		perror("[KFMon] [ERR!] read");
+	}
+	close(fd);
+
+	// The status line only decides our exit code, the rest goes to stdout. Errors go to stderr, as-is.
+	bool is_ok = nread == 0 && reply_len >= 3U && strncmp(reply, "OK\n", 3U) == 0;
+	if (is_ok) {
+		fwrite(reply + 3, 1U, reply_len - 3U, stdout);
+	} else if (reply_len > 0U) {
+		fwrite(reply, 1U, reply_len, stderr);
+	}
+	free(reply);
+
+	return is_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,184 @@
+/*
+	KFMon: Kobo inotify-based launcher
+	Copyright (C) 2016-2019 NiLuJe <ninuje@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Affero General Public License as
+	published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Affero General Public License for more details.
+
+	You should have received a copy of the GNU Affero General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Decode KFMon's binary event journal (c.f., journal.h) to text, oldest event first.
+
+#ifndef _GNU_SOURCE
+#	define _GNU_SOURCE
+#endif
+
+#include "../journal.h"
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef NILUJE
+#	define KFMON_JOURNAL "/usr/local/kfmon/kfmon.journal"
+#else
+#	define KFMON_JOURNAL "/home/niluje/Kindle/Staging/kfmon.journal"
+#endif
+
+static const char* get_decision_name(uint8_t) __attribute__((const));
+static void        format_mask(uint32_t, char*, size_t);
+static void        print_record(const JournalRecord*);
+
+static const char*
+    get_decision_name(uint8_t decision)
+{
+	switch (decision) {
+		case JOURNAL_NONE:
+			return "-";
+		case JOURNAL_SPAWNED:
+			return "spawned";
+		case JOURNAL_BLOCKED:
+			return "blocked";
+		case JOURNAL_BUSY:
+			return "busy";
+		case JOURNAL_PENDING:
+			return "pending";
+		case JOURNAL_FAILED:
+			return "failed";
+		case JOURNAL_DEFERRED:
+			return "deferred";
+		case JOURNAL_COALESCED:
+			return "coalesced";
+		default:
+			return "???";
+	}
+}
+
+// Human-readable version of the inotify event mask (only the flags we actually care about)
+static void
+    format_mask(uint32_t mask, char* buf, size_t len)
+{
+	const struct
+	{
+		uint32_t    flag;
+		const char* name;
+	} flags[] = { { IN_OPEN, "OPEN" },         { IN_CLOSE_WRITE, "CLOSE_WRITE" },
+		      { IN_CLOSE_NOWRITE, "CLOSE" }, { IN_UNMOUNT, "UNMOUNT" },
+		      { IN_IGNORED, "IGNORED" },     { IN_Q_OVERFLOW, "Q_OVERFLOW" } };
+
+	buf[0]     = '\0';
+	size_t pos = 0U;
+	for (size_t i = 0U; i < sizeof(flags) / sizeof(*flags); i++) {
+		if (mask & flags[i].flag) {
+			int ret = snprintf(buf + pos, len - pos, "%s%s", pos ? "|" : "", flags[i].name);
+			if (ret < 0 || (size_t) ret >= len - pos) {
+				break;
+			}
+			pos += (size_t) ret;
+		}
+	}
+	if (pos == 0U) {
+		snprintf(buf, len, "0x%x", mask);
+	}
+}
+
+static void
+    print_record(const JournalRecord* rec)
+{
+	time_t    t = (time_t)(rec->ts_ns / 1000000000U);
+	struct tm local_tm;
+	char      sz_time[22];
+	strftime(sz_time, sizeof(sz_time), "%Y-%m-%d @ %H:%M:%S", localtime_r(&t, &local_tm));
+
+	char sz_mask[64];
+	format_mask(rec->mask, sz_mask, sizeof(sz_mask));
+
+	char sz_watch[16];
+	if (rec->watch_idx == UINT32_MAX) {
+		snprintf(sz_watch, sizeof(sz_watch), "%s", "-");
+	} else {
+		snprintf(sz_watch, sizeof(sz_watch), "%u", rec->watch_idx);
+	}
+
+	printf("[%s.%03u] watch %-4s %-14s %-8s check %6uus spawn %6uus",
+	       sz_time,
+	       (unsigned int) ((rec->ts_ns / 1000000U) % 1000U),
+	       sz_watch,
+	       sz_mask,
+	       get_decision_name(rec->decision),
+	       rec->check_us,
+	       rec->spawn_us);
+	if (rec->pid > 0) {
+		printf(" pid %d", rec->pid);
+	}
+	printf("\n");
+}
+
+int
+    main(int argc, char* argv[])
+{
+	const char* path = argc > 1 ? argv[1] : KFMON_JOURNAL;
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		perror("[KFMon] [ERR!] open");
+		return EXIT_FAILURE;
+	}
+	struct stat st;
+	if (fstat(fd, &st) == -1) {
+		perror("[KFMon] [ERR!] fstat");
+		close(fd);
+		return EXIT_FAILURE;
+	}
+	if ((size_t) st.st_size < sizeof(JournalHeader)) {
+		fprintf(stderr, "'%s' is too small to be a KFMon journal!\n", path);
+		close(fd);
+		return EXIT_FAILURE;
+	}
+
+	void* map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		perror("[KFMon] [ERR!] mmap");
+		return EXIT_FAILURE;
+	}
+
+	const JournalHeader* header = (const JournalHeader*) map;
+	if (memcmp(header->magic, KFMON_JOURNAL_MAGIC, sizeof(header->magic)) != 0 ||
+	    header->version != KFMON_JOURNAL_VERSION || header->record_size != sizeof(JournalRecord) ||
+	    header->capacity == 0U ||
+	    (size_t) st.st_size < sizeof(JournalHeader) + (size_t) header->capacity * sizeof(JournalRecord)) {
+		fprintf(stderr, "'%s' is not a KFMon journal we know how to read!\n", path);
+		munmap(map, (size_t) st.st_size);
+		return EXIT_FAILURE;
+	}
+	const JournalRecord* records = (const JournalRecord*) ((const unsigned char*) map + sizeof(JournalHeader));
+
+	// NOTE: Snapshot the counter, since kfmon may very well be writing to it as we speak.
+	uint64_t next  = header->next;
+	uint64_t first = next > header->capacity ? next - header->capacity : 0U;
+	printf("%llu events logged, showing the last %llu:\n",
+	       (unsigned long long) next,
+	       (unsigned long long) (next - first));
+	for (uint64_t i = first; i < next; i++) {
+		print_record(&records[i % header->capacity]);
+	}
+
+	munmap(map, (size_t) st.st_size);
+	return EXIT_SUCCESS;
+}